@@ -9,10 +9,13 @@
 #pragma once
 
 #include "../Core/array.h"
+#include <algorithm>
 
 template<class T> struct PriorityQueueEntry {
   double p;
   T x;
+  long tie=0;   ///< orders entries of equal p (FIFO or LIFO, see PriorityQueue::add)
+  uint handle=0;
 
   void write(std::ostream& os) const { os <<'[' <<p <<": " <<*x <<']' <<endl; }
   static bool cmp(const PriorityQueueEntry<T>& a, const PriorityQueueEntry<T>& b);
@@ -29,28 +32,96 @@ template<class T> bool operator<=(const PriorityQueueEntry<T>& a, const Priority
   return a.p <= b.p;
 }
 
+/// min-priority queue as a binary heap (the array is heap-ordered, not sorted -- only first() is the minimum; use
+/// sorted() for the pop order); add returns a handle that stays valid while the entry is queued, e.g. for decreaseKey --
+/// handles of popped entries are reused by later adds
 template<class T> struct PriorityQueue : rai::Array<PriorityQueueEntry<T>> {
+  typedef rai::Array<PriorityQueueEntry<T>> Heap;
+  uintA heapPos; ///< for each handle, its index in the heap (UINT_MAX if popped)
+  uintA freeHandles; ///< handles of popped entries, to be reused (so heapPos is bounded by the maximal queue size)
+  long count=0;
+
   PriorityQueue() {
-    rai::Array<PriorityQueueEntry<T>>::memMove = true;
+    Heap::memMove = true;
   }
 
-  void add(double p, const T& x, bool fromBackIfEqual=false) { //'fromBack=true' makes it a FIFO (breadth first search); otherwise LIFO (depth first search)
-    PriorityQueueEntry<T> e = {p, x};
-    rai::Array<PriorityQueueEntry<T>>::insertInSorted(e, PriorityQueueEntry<T>::cmp, fromBackIfEqual);
+  uint add(double p, const T& x, bool fromBackIfEqual=false) { //'fromBack=true' makes it a FIFO (breadth first search); otherwise LIFO (depth first search)
+    count++;
+    PriorityQueueEntry<T> e = {p, x, fromBackIfEqual?count:-count, 0};
+    if(freeHandles.N) {
+      e.handle = freeHandles.popLast();
+      heapPos(e.handle) = Heap::N;
+    } else {
+      e.handle = heapPos.N;
+      heapPos.append(Heap::N);
+    }
+    Heap::append(e);
+    siftUp(Heap::N-1);
+    return e.handle;
   }
 
   T pop() {
-    T x=rai::Array<PriorityQueueEntry<T>>::first().x;
-    rai::Array<PriorityQueueEntry<T>>::remove(0);
+    T x=Heap::first().x;
+    heapPos(Heap::first().handle) = UINT_MAX;
+    freeHandles.append(Heap::first().handle);
+    if(Heap::N>1) place(0, Heap::last());
+    Heap::resizeCopy(Heap::N-1);
+    if(Heap::N) siftDown(0);
     return x;
   }
 
-  //  void add_replace(double p, const T& x){
-  //    PriorityQueueEntry<T> e = {p, x};
-  //    uint pos = rankInSorted(e, cmp_PriorityQueueEntry);
-  //    PriorityQueueEntry<T>& e_after = elem(pos);
-  //    if(e_after.x==e.x){
-  //      if(e_after)
-  //      e_after.p =
-  //  }
+  bool isQueued(uint handle) const { return handle<heapPos.N && heapPos(handle)!=UINT_MAX; }
+
+  const PriorityQueueEntry<T>& get(uint handle) const { CHECK(isQueued(handle), "handle " <<handle <<" is not queued"); return Heap::elem(heapPos(handle)); }
+
+  /// the queued entries in pop order (a sorted copy of the heap)
+  Heap sorted() const {
+    Heap S = *this;
+    std::sort(S.p, S.p+S.N, less);
+    return S;
+  }
+
+  /// lower the priority of a queued entry
+  void decreaseKey(uint handle, double p) {
+    CHECK(isQueued(handle), "handle " <<handle <<" is not queued");
+    uint i = heapPos(handle);
+    CHECK_LE(p, Heap::elem(i).p, "decreaseKey can't increase the priority");
+    Heap::elem(i).p = p;
+    siftUp(i);
+  }
+
+ private:
+  static bool less(const PriorityQueueEntry<T>& a, const PriorityQueueEntry<T>& b) {
+    return a.p<b.p || (a.p==b.p && a.tie<b.tie);
+  }
+
+  void place(uint i, const PriorityQueueEntry<T>& e) {
+    Heap::elem(i) = e;
+    heapPos(e.handle) = i;
+  }
+
+  void siftUp(uint i) {
+    PriorityQueueEntry<T> e = Heap::elem(i);
+    while(i) {
+      uint parent = (i-1)/2;
+      if(!less(e, Heap::elem(parent))) break;
+      place(i, Heap::elem(parent));
+      i = parent;
+    }
+    place(i, e);
+  }
+
+  void siftDown(uint i) {
+    PriorityQueueEntry<T> e = Heap::elem(i);
+    uint n = Heap::N;
+    for(;;) {
+      uint child = 2*i+1;
+      if(child>=n) break;
+      if(child+1<n && less(Heap::elem(child+1), Heap::elem(child))) child++;
+      if(!less(Heap::elem(child), e)) break;
+      place(i, Heap::elem(child));
+      i = child;
+    }
+    place(i, e);
+  }
 };
@@ -19,6 +19,8 @@
 #include "array.h"
 #include "util.h"
 
+#include <atomic>
+
 #ifdef RAI_LAPACK
 extern "C" {
 #include "cblas.h"
@@ -58,12 +60,169 @@ const bool lapackSupported=true;
 #else
 const bool lapackSupported=false;
 #endif
-uint64_t globalMemoryTotal=0, globalMemoryBound=1ull<<30; //this is 1GB
+MemoryCounter globalMemoryTotal;
+uint64_t globalMemoryBound=0;
 bool globalMemoryStrict=false;
 const char* arrayElemsep=", ";
 const char* arrayLinesep=",\n ";
 const char* arrayBrackets="[]";
 
+//===========================================================================
+//
+// memory accounting
+//
+
+static const uint memorySlots=64;
+static const int64_t memoryPeakBatch=1<<16;
+
+/// per-tag counts of one thread (the only writer); the last slot is shared (atomic adds) by threads beyond memorySlots
+struct alignas(64) MemorySlot { std::atomic<int64_t> bytes[MT_numTags]; };
+static MemorySlot memorySlot[memorySlots+1];  //(zero-initialized before any dynamic initialization)
+static std::atomic<uint64_t> memoryFreeSlots(~0ull);
+static std::atomic<int64_t> memoryRunning(0), memoryPeak(0);
+static std::atomic<bool> memoryWarned(false);
+
+/// trivially destructible: Arrays in static storage are still freed after the thread's destructors ran;
+/// default (dynamic) TLS model, as libCore may be dlopen'ed (e.g. by the ry python module)
+struct ThreadMemory {
+  MemorySlot* slot;
+  int64_t drift;
+  MemoryTag tag;
+};
+static thread_local ThreadMemory threadMemory = { 0, 0, MT_untagged };
+
+/// hands the thread's slot back on thread exit (its counts stay: memory may be freed by other threads)
+struct MemorySlotLease {
+  uint i;
+  MemorySlotLease() {
+    uint64_t free=memoryFreeSlots.load();
+    do { i = free ? __builtin_ctzll(free) : memorySlots; } while(free && !memoryFreeSlots.compare_exchange_weak(free, free&~(1ull<<i)));
+    threadMemory.slot = memorySlot+i;
+  }
+  ~MemorySlotLease() {
+    threadMemory.slot = memorySlot+memorySlots;
+    if(i<memorySlots) memoryFreeSlots.fetch_or(1ull<<i);
+  }
+};
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : old(threadMemory.tag) { threadMemory.tag=tag; }
+MemoryTagScope::~MemoryTagScope() { threadMemory.tag=old; }
+
+MemoryTag currentMemoryTag() { return threadMemory.tag; }
+
+MemoryTag accountMemory(int64_t bytes, int tag) {
+  ThreadMemory& T = threadMemory;
+  if(!T.slot) { static thread_local MemorySlotLease lease; (void)lease; }
+  if(tag<0) tag=T.tag;
+  std::atomic<int64_t>& count = T.slot->bytes[tag];
+  if(T.slot!=memorySlot+memorySlots) count.store(count.load(std::memory_order_relaxed)+bytes, std::memory_order_relaxed);
+  else count.fetch_add(bytes, std::memory_order_relaxed);
+  T.drift += bytes;
+  if(T.drift<memoryPeakBatch && T.drift>-memoryPeakBatch) return (MemoryTag)tag;
+
+  //-- batched update of the running total: high-water mark and soft bound
+  int64_t total = memoryRunning.fetch_add(T.drift, std::memory_order_relaxed) + T.drift;
+  T.drift=0;
+  if(globalMemoryBound && bytes>0 && (uint64_t)total>globalMemoryBound) {
+    if(globalMemoryStrict) { //undo, then throw
+      if(T.slot!=memorySlot+memorySlots) count.store(count.load(std::memory_order_relaxed)-bytes, std::memory_order_relaxed);
+      else count.fetch_sub(bytes, std::memory_order_relaxed);
+      memoryRunning.fetch_sub(bytes, std::memory_order_relaxed);
+      HALT("strict memory bound exceeded: allocating " <<bytes <<" bytes (total=" <<(total>>20) <<"MB, bound=" <<(globalMemoryBound>>20) <<"MB)");
+    }
+    if(!memoryWarned.exchange(true)) {
+      RAI_MSG("memory bound exceeded: total=" <<(total>>20) <<"MB, bound=" <<(globalMemoryBound>>20) <<"MB (warning only once)");
+    }
+  }
+  int64_t peak = memoryPeak.load(std::memory_order_relaxed);
+  while(total>peak && !memoryPeak.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {}
+  return (MemoryTag)tag;
+}
+
+uint64_t MemoryCounter::byTag(MemoryTag tag) const {
+  int64_t s=0;
+  for(uint i=0; i<=memorySlots; i++) s += memorySlot[i].bytes[tag].load(std::memory_order_relaxed);
+  return s>0 ? s : 0;
+}
+
+uint64_t MemoryCounter::total() const {
+  int64_t s=0;
+  for(uint i=0; i<=memorySlots; i++) for(uint t=0; t<MT_numTags; t++) s += memorySlot[i].bytes[t].load(std::memory_order_relaxed);
+  return s>0 ? s : 0;
+}
+
+uint64_t MemoryCounter::peak() const {
+  uint64_t p=memoryPeak.load(std::memory_order_relaxed), t=total();
+  return p>t ? p : t;
+}
+
+void MemoryCounter::resetPeak() { memoryPeak=total(); }
+
+//===========================================================================
+//
+// scratch arena
+//
+
+uint64_t ArenaScope::chunkSize=1ull<<16; //stays below malloc's mmap threshold, so that retired chunks are recycled cheaply
+
+/// a block of arena memory; each allocation is preceded by a 16-byte header pointing to its chunk
+struct ArenaChunk {
+  std::atomic<int> refs; ///< live allocations, +1 while it is the current chunk of its thread
+  uint64_t size, used;
+};
+static const uint64_t arenaChunkHeader = (sizeof(ArenaChunk)+15)&~15ull;
+
+static void releaseChunk(ArenaChunk* c) {
+  if(--c->refs==0) { c->~ArenaChunk();  free(c); }
+}
+
+struct ThreadArena {
+  ArenaChunk* chunk=0;
+  uint depth=0;
+  ~ThreadArena() { if(chunk) releaseChunk(chunk); }
+};
+static thread_local ThreadArena threadArena;
+
+ArenaScope::ArenaScope(bool active) : active(active) { if(active) threadArena.depth++; }
+
+ArenaScope::~ArenaScope() {
+  if(!active) return;
+  ThreadArena& A = threadArena;
+  if(--A.depth || !A.chunk) return;
+  if(A.chunk->refs==1) A.chunk->used=0; //nothing escaped: rewind
+  else { releaseChunk(A.chunk);  A.chunk=0; } //retire: freed with the last escaped array
+}
+
+ArenaPause::ArenaPause() : depth(threadArena.depth) { threadArena.depth=0; }
+
+ArenaPause::~ArenaPause() { threadArena.depth=depth; }
+
+void* arenaMalloc(uint64_t size) {
+  ThreadArena& A = threadArena;
+  if(!A.depth) return NULL;
+  uint64_t need = 16 + ((size+15)&~15ull);
+  if(need>ArenaScope::chunkSize/4) return NULL;
+  ArenaChunk* c = A.chunk;
+  if(!c || c->used+need>c->size) {
+    if(c) releaseChunk(c);
+    void* mem = malloc(arenaChunkHeader+ArenaScope::chunkSize);
+    if(!mem) return NULL;
+    c = A.chunk = new(mem) ArenaChunk;
+    c->refs=1;
+    c->size=ArenaScope::chunkSize;
+    c->used=0;
+  }
+  char* q = (char*)c + arenaChunkHeader + c->used;
+  *(ArenaChunk**)q = c;
+  c->used += need;
+  c->refs++;
+  return q+16;
+}
+
+void arenaFree(void* p) {
+  if(p) releaseChunk(*(ArenaChunk**)((char*)p-16));
+}
+
 //===========================================================================
 }
 
@@ -1182,9 +1341,6 @@ void sparseProduct(arr& y, arr& A, const arr& x) {
     op_innerProduct(y, A, x);
     return;
   }
-#if 0
-  NIY; //replace by Eigen
-#else
   if(isSparseMatrix(A) && !isSparseVector(x)) {
     uint i, j;
     int* k, *kstop;
@@ -1250,7 +1406,6 @@ void sparseProduct(arr& y, arr& A, const arr& x) {
     }
     return;
   }
-#endif
 }
 
 void scanArrFile(const char* name) {
@@ -1939,12 +2094,63 @@ arr eigen_Ainv_b(const arr& A, const arr& b) {
   return NoArr;
 }
 
+struct rai::sSparseCholesky {
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+  Eigen::SparseMatrix<double> A; //the last factorized matrix (its pattern is the one analyzed)
+  bool analyzed=false;
+};
+
+rai::SparseCholesky::SparseCholesky() : self(make_unique<sSparseCholesky>()) {}
+
+rai::SparseCholesky::~SparseCholesky() {}
+
+arr rai::SparseCholesky::solve(const arr& A, const arr& b, double shift) {
+  CHECK(isSparseMatrix(A), "");
+  CHECK_EQ(A.d0, A.d1, "");
+  CHECK_EQ(A.d0, b.d0, "");
+  Eigen::SparseMatrix<double> Aeig = conv_sparseArr2sparseEigen(A.sparse());
+
+  //-- symbolic phase only if the pattern changed
+  Eigen::SparseMatrix<double>& Aold = self->A;
+  bool samePattern = self->analyzed
+                     && Aeig.rows()==Aold.rows() && Aeig.nonZeros()==Aold.nonZeros()
+                     && std::equal(Aeig.outerIndexPtr(), Aeig.outerIndexPtr()+Aeig.outerSize()+1, Aold.outerIndexPtr())
+                     && std::equal(Aeig.innerIndexPtr(), Aeig.innerIndexPtr()+Aeig.nonZeros(), Aold.innerIndexPtr());
+  Aold = std::move(Aeig);
+  if(!samePattern) {
+    self->solver.analyzePattern(Aold);
+    self->analyzed=true;
+    analyzeCount++;
+  }
+
+  //-- numeric phase
+  self->solver.setShift(shift);
+  self->solver.factorize(Aold);
+  factorizeCount++;
+  if(self->solver.info()!=Eigen::Success || self->solver.vectorD().minCoeff()<=0.) {
+    rai::errString <<"SparseCholesky: factorization failed. Typically this is because A is not pos-def.";
+    throw(rai::errString.p);
+  }
+
+  Eigen::MatrixXd x = self->solver.solve(conv_arr2eigen(b));
+  if(self->solver.info()!=Eigen::Success) {
+    rai::errString <<"SparseCholesky: solving failed";
+    throw(rai::errString.p);
+  }
+  return conv_eigen2arr(x);
+}
+
 #else //RAI_EIGEN
 
 //Eigen::SparseMatrix<double> conv_sparseArr2sparseEigen(const rai::SparseMatrix& S){ NICO }
 //arr conv_sparseEigen2sparseArr(Eigen::SparseMatrix<double>& E){ NICO }
 arr eigen_Ainv_b(const arr& A, const arr& b) { NICO }
 
+struct rai::sSparseCholesky {};
+rai::SparseCholesky::SparseCholesky() {}
+rai::SparseCholesky::~SparseCholesky() {}
+arr rai::SparseCholesky::solve(const arr& A, const arr& b, double shift) { NICO }
+
 #endif //RAI_EIGEN
 
 //===========================================================================
@@ -2519,27 +2725,11 @@ void SparseMatrix::colShift(int shift) {
   }
 }
 
-#ifdef RAI_EIGEN
-
-arr SparseMatrix::At_x(const arr& x) {
-  Eigen::SparseMatrix<double> A_eig = conv_sparseArr2sparseEigen(*this);
-  Eigen::MatrixXd x_eig = conv_arr2eigen(x);
-
-  x_eig = A_eig.transpose() * x_eig;
-
-  arr y(x_eig.rows());
-  for(uint i = 0; i<y.d0; i++) y(i) = x_eig(i, 0);
-  return y;
-}
-
-arr SparseMatrix::At_A() {
-  Eigen::SparseMatrix<double> s = conv_sparseArr2sparseEigen(*this);
+arr SparseMatrix::At_x(const arr& x) { return CSR(Z).At_x(x); }
 
-  Eigen::SparseMatrix<double> W(Z.d1, Z.d1);
-  W = s.transpose() * s;
+arr SparseMatrix::At_A() { return CSR(Z).At_A(); }
 
-  return conv_sparseEigen2sparseArr(W);
-}
+#ifdef RAI_EIGEN
 
 arr SparseMatrix::A_B(const arr& B) const {
   if(!B.isSparse() && B.N<25){
@@ -2591,8 +2781,6 @@ arr SparseMatrix::B_A(const arr& B) const {
 
 #else //RAI_EIGEN
 
-arr SparseMatrix::At_x(const arr& x) { NICO }
-arr SparseMatrix::At_A() { NICO }
 arr SparseMatrix::A_B(const arr& B) const { NICO }
 arr SparseMatrix::B_A(const arr& B) const { NICO }
 
@@ -2802,9 +2990,495 @@ arr rai::comp_At(const arr& A) {
 arr rai::comp_A_x(const arr& A, const arr& x) {
   if(!isSpecial(A)) { arr y; op_innerProduct(y, A, x); return y; }
   if(isRowShifted(A)) return ((rai::RowShifted*)A.special)->A_x(x);
+  if(isSparseMatrix(A)) return rai::CSR(A).A_x(x);
   return NoArr;
 }
 
+//===========================================================================
+//
+// forward-mode autodiff
+//
+
+namespace rai {
+
+/// visits the non-zeros (row, col, value) of a dense, sparse or row-shifted matrix
+template<class F> static void forEachEntry(const arr& B, const F& f) {
+  if(isSparseMatrix(B)) {
+    const int* e = B.sparse().elems.p;
+    for(uint k=0; k<B.N; k++) f(e[2*k], e[2*k+1], B.p[k]);
+  } else if(isRowShifted(B)) {
+    const RowShifted& R = B.rowShifted();
+    for(uint i=0; i<B.d0; i++) {
+      uint shift = R.rowShift.p[i];
+      const double* b = B.p+i*R.rowSize;
+      for(uint j=0; j<R.rowSize && shift+j<B.d1; j++) if(b[j]) f(i, shift+j, b[j]);
+    }
+  } else {
+    CHECK_EQ(B.nd, 2, "Jacobians are matrices");
+    const double* b = B.p;
+    for(uint i=0; i<B.d0; i++) for(uint j=0; j<B.d1; j++, b++) if(*b) f(i, j, *b);
+  }
+}
+
+static arr jac_sparse(const arr& B) {
+  arr A;
+  SparseMatrix& S = A.sparse();
+  uint n=0, l=0;
+  forEachEntry(B, [&](uint, uint, double) { n++; });
+  S.resize(B.d0, B.d1, n);
+  forEachEntry(B, [&](uint i, uint j, double v) { S.entry(i, j, l++) = v; });
+  return A;
+}
+
+static uintA straight(uint n, uint lo=0) {
+  uintA s(n);
+  for(uint i=0; i<n; i++) s.p[i] = lo+i;
+  return s;
+}
+
+void jac_add(std::unique_ptr<arr>& J, const arr& B, double coeff) {
+  if(!J) {
+    J = make_unique<arr>(B);
+    if(coeff!=1.) *J *= coeff;
+    return;
+  }
+  arr& A = *J;
+  CHECK(A.d0==B.d0 && A.d1==B.d1, "Jacobians of different shape: " <<A.dim() <<" vs " <<B.dim());
+  if(!isSpecial(A) && !isSpecial(B)) {
+    double* a=A.p, *astop=a+A.N;
+    const double* b=B.p;
+    for(; a!=astop; a++, b++) *a += coeff * *b;
+  } else if(!isSpecial(A)) {
+    forEachEntry(B, [&](uint i, uint j, double v) { A.p[i*A.d1+j] += coeff*v; });
+  } else {
+    if(!isSparseMatrix(A)) A = jac_sparse(A);
+    if(isSparseMatrix(B)) { A.sparse().add(B.sparse(), 0, 0, coeff); return; }
+    SparseMatrix& S = A.sparse();
+    uint n=0, l=A.N;
+    forEachEntry(B, [&](uint, uint, double) { n++; });
+    S.resizeCopy(A.d0, A.d1, l+n);
+    forEachEntry(B, [&](uint i, uint j, double v) { S.entry(i, j, l++) = coeff*v; });
+  }
+}
+
+arr jac_rowMap(const arr& B, uint d0, const uintA& dst, const uintA& src, const arr& w) {
+  CHECK(dst.N==src.N && w.N==src.N, "");
+  arr J;
+  if(!isSpecial(B)) {
+    uint d1=B.d1;
+    J.resize(d0, d1).setZero();
+    for(uint k=0; k<src.N; k++) {
+      double wk=w.p[k];
+      if(!wk) continue;
+      double* a=J.p+dst.p[k]*d1;
+      const double* b=B.p+src.p[k]*d1, *bstop=b+d1;
+      for(; b!=bstop; a++, b++) *a += wk * *b;
+    }
+    return J;
+  }
+
+  //-- sparse: sort the map by source row, then expand each non-zero of B into the rows that read it
+  uintA start(B.d0+1), order(src.N);
+  start.setZero();
+  for(uint k=0; k<src.N; k++) if(w.p[k]) start.p[src.p[k]+1]++;
+  for(uint i=0; i<B.d0; i++) start.p[i+1] += start.p[i];
+  uintA next = start;
+  for(uint k=0; k<src.N; k++) if(w.p[k]) order.p[next.p[src.p[k]]++] = k;
+  uint n=0, l=0;
+  forEachEntry(B, [&](uint i, uint, double) { n += start.p[i+1]-start.p[i]; });
+  SparseMatrix& S = J.sparse();
+  S.resize(d0, B.d1, n);
+  forEachEntry(B, [&](uint i, uint j, double v) {
+    for(uint m=start.p[i]; m<start.p[i+1]; m++) { uint k=order.p[m]; S.entry(dst.p[k], j, l++) = w.p[k]*v; }
+  });
+  return J;
+}
+
+/// x.jac for x_r = sum_k c_k y_a z_b, given the terms (r, a, b) as rows of a Kx3 array (c=NoArr: all 1)
+static void diff_bilinear(arr& x, const arr& y, const arr& z, const uintA& terms, const arr& c=NoArr) {
+  CHECK(!isSpecial(y) && !isSpecial(z), "AutoDiff NIY for products with sparse matrices");
+  uint K=terms.d0;
+  uintA r(K), a(K), b(K);
+  for(uint k=0; k<K; k++) { r.p[k]=terms.p[3*k];  a.p[k]=terms.p[3*k+1];  b.p[k]=terms.p[3*k+2]; }
+  arr w(K);
+  std::unique_ptr<arr> J;
+  if(y.jac) {
+    for(uint k=0; k<K; k++) w.p[k] = (!!c ? c.p[k] : 1.) * z.p[b.p[k]];
+    jac_add(J, jac_rowMap(*y.jac, x.N, r, a, w));
+  }
+  if(z.jac) {
+    for(uint k=0; k<K; k++) w.p[k] = (!!c ? c.p[k] : 1.) * y.p[a.p[k]];
+    jac_add(J, jac_rowMap(*z.jac, x.N, r, b, w));
+  }
+  x.jac = std::move(J);
+}
+
+void diff_binary(arr& x, const arr& y, const arr& z, char op) {
+  uintA terms;
+  arr c;
+  uint k=0;
+  auto term = [&](uint r, uint a, uint b) { uint* t=terms.p+3*(k++); t[0]=r; t[1]=a; t[2]=b; };
+  if(op=='*') {
+    if(y.nd==2 && z.nd==1) {
+      if(!y.jac) { x.jac = make_unique<arr>(y * *z.jac); return; } //keeps the format of z.jac
+      terms.resize(y.N, 3);
+      for(uint i=0; i<y.d0; i++) for(uint j=0; j<y.d1; j++) term(i, i*y.d1+j, j);
+    } else if(y.nd==2 && z.nd==2) {
+      uint d0=y.d0, dk=y.d1, d1=z.d1;
+      terms.resize(d0*d1*dk, 3);
+      for(uint i=0; i<d0; i++) for(uint j=0; j<d1; j++) for(uint l=0; l<dk; l++) term(i*d1+j, i*dk+l, l*d1+j);
+    } else if(y.nd==1 && z.nd==1 && z.N==1) {
+      terms.resize(y.N, 3);
+      for(uint i=0; i<y.N; i++) term(i, i, 0);
+    } else if(y.nd==1 && z.nd==2 && z.d0==1) {
+      terms.resize(y.N*z.d1, 3);
+      for(uint i=0; i<y.N; i++) for(uint j=0; j<z.d1; j++) term(i*z.d1+j, i, j);
+    } else HALT("AutoDiff NIY for inner product of dimensions " <<y.dim() <<" " <<z.dim());
+  } else if(op=='%') {
+    terms.resize(x.N, 3);
+    if(y.N==1) for(uint r=0; r<x.N; r++) term(r, 0, r);
+    else if(y.nd==1 && z.nd==2) for(uint r=0; r<x.N; r++) term(r, r/z.d1, r);
+    else if(y.nd==2 && z.nd==1) for(uint r=0; r<x.N; r++) term(r, r, r%y.d1);
+    else for(uint r=0; r<x.N; r++) term(r, r, r);
+  } else if(op=='.') {
+    terms.resize(x.N, 3);
+    for(uint r=0; r<x.N; r++) term(r, r, r);
+  } else if(op=='^') {
+    terms.resize(y.N*z.N, 3);
+    for(uint a=0; a<y.N; a++) for(uint b=0; b<z.N; b++) term(a*z.N+b, a, b);
+  } else if(op=='x') {
+    CHECK(y.nd==1 && z.nd==1, "AutoDiff NIY for column-wise cross products");
+    terms.resize(6, 3);
+    term(0, 1, 2);  term(0, 2, 1);
+    term(1, 2, 0);  term(1, 0, 2);
+    term(2, 0, 1);  term(2, 1, 0);
+    c = {1., -1., 1., -1., 1., -1.};
+  } else HALT("AutoDiff NIY for operator " <<op);
+  diff_bilinear(x, y, z, terms, c.N ? c : NoArr);
+}
+
+void diff_update(arr& x, const arr& y, char op) {
+  if(op=='+') { if(y.jac) jac_add(x.jac, *y.jac);  return; }
+  if(op=='-') { if(y.jac) jac_add(x.jac, *y.jac, -1.);  return; }
+  CHECK(op=='*' || op=='/', "AutoDiff: operator " <<op <<"= is not differentiable");
+  //called before the update: (x*y)' = y x' + x y',  (x/y)' = x'/y - x/y^2 y'
+  arr gx(x.N), gy(x.N);
+  for(uint i=0; i<x.N; i++) {
+    if(op=='*') { gx.p[i] = y.p[i];  gy.p[i] = x.p[i]; }
+    else { gx.p[i] = 1./y.p[i];  gy.p[i] = -x.p[i]/(y.p[i]*y.p[i]); }
+  }
+  std::unique_ptr<arr> J;
+  if(x.jac) J = make_unique<arr>(gx % *x.jac);
+  if(y.jac) jac_add(J, gy % *y.jac);
+  x.jac = std::move(J);
+}
+
+void diff_update(arr& x, double y, char op) {
+  if(op=='+' || op=='-') return;
+  if(op=='*') { *x.jac *= y;  return; }
+  if(op=='/') { *x.jac /= y;  return; }
+  HALT("AutoDiff: operator " <<op <<"= is not differentiable");
+}
+
+void diff_transpose(arr& x, const arr& y) {
+  if(y.nd==1) { x.jac = make_unique<arr>(*y.jac);  return; }
+  uintA dst(y.N), src(y.N);
+  uint k=0;
+  if(y.nd==2) {
+    for(uint i=0; i<y.d0; i++) for(uint j=0; j<y.d1; j++, k++) { dst.p[k] = j*y.d0+i;  src.p[k] = k; }
+  } else {
+    for(uint i=0; i<y.d2; i++) for(uint j=0; j<y.d1; j++) for(uint l=0; l<y.d0; l++, k++) { dst.p[k] = k;  src.p[k] = (l*y.d1+j)*y.d2+i; }
+  }
+  x.jac = make_unique<arr>(jac_rowMap(*y.jac, x.N, dst, src, ones(y.N)));
+}
+
+void diff_range(arr& x, const arr& y, uint lo) {
+  if(!x.N) return;
+  const arr& J = *y.jac;
+  if(!isSpecial(J)) {
+    x.jac = make_unique<arr>(J.p+lo*J.d1, x.N*J.d1, false);
+    x.jac->reshape(x.N, J.d1);
+  } else {
+    x.jac = make_unique<arr>(jac_rowMap(J, x.N, straight(x.N), straight(x.N, lo), ones(x.N)));
+  }
+}
+
+void diff_append(arr& x, const arr& y, uint oldN) {
+  std::unique_ptr<arr> J;
+  if(x.jac) jac_add(J, jac_rowMap(*x.jac, x.N, straight(oldN), straight(oldN), ones(oldN)));
+  if(y.jac) jac_add(J, jac_rowMap(*y.jac, x.N, straight(y.N, oldN), straight(y.N), ones(y.N)));
+  x.jac = std::move(J);
+}
+
+arr diff_sum(const arr& x) {
+  arr y = {sum(x)};
+  if(x.jac) y.jac = make_unique<arr>(jac_rowMap(*x.jac, 1, consts<uint>(0, x.N), straight(x.N), ones(x.N)));
+  return y;
+}
+
+arr diff_sumOfSqr(const arr& x) {
+  arr y = {sumOfSqr(x)};
+  if(x.jac) {
+    arr w(x.N);
+    for(uint i=0; i<x.N; i++) w.p[i] = 2.*x.p[i];
+    y.jac = make_unique<arr>(jac_rowMap(*x.jac, 1, consts<uint>(0, x.N), straight(x.N), w));
+  }
+  return y;
+}
+
+arr diff_length(const arr& x) {
+  double l = length(x);
+  arr y = {l};
+  if(x.jac) {
+    arr w(x.N);
+    for(uint i=0; i<x.N; i++) w.p[i] = l>0. ? x.p[i]/l : 0.;
+    y.jac = make_unique<arr>(jac_rowMap(*x.jac, 1, consts<uint>(0, x.N), straight(x.N), w));
+  }
+  return y;
+}
+
+arr diff_scalarProduct(const arr& x, const arr& y) {
+  arr s = {scalarProduct(x, y)};
+  CHECK_EQ(x.N, y.N, "");
+  uintA terms(x.N, 3);
+  for(uint i=0; i<x.N; i++) { terms.p[3*i]=0;  terms.p[3*i+1]=terms.p[3*i+2]=i; }
+  if(x.jac || y.jac) diff_bilinear(s, x, y, terms);
+  return s;
+}
+
+void diff_chain(arr& y, const arr& J, const arr& x) {
+  if(!x.jac) return;
+  jac_add(y.jac, J * *x.jac);
+}
+
+//===========================================================================
+//
+// CSR
+//
+
+void CSR::set(const arr& A) {
+  CHECK_EQ(A.nd, 2, "");
+  bool sparse = isSparseMatrix(A);
+
+  //-- same pattern as last time: only the values change
+  if(sparse && A.d0==d0 && A.d1==d1 && srcPos.N==A.N && srcElems.N==A.sparse().elems.N
+      && !memcmp(srcElems.p, A.sparse().elems.p, srcElems.N*srcElems.sizeT)) {
+    vals.setZero();
+    for(uint k=0; k<A.N; k++) vals.p[srcPos.p[k]] += A.p[k];
+    return;
+  }
+
+  //-- collect the entries
+  d0=A.d0; d1=A.d1;
+  uint n=0;
+  forEachEntry(A, [&](uint, uint, double) { n++; });
+  uintA row(n), col(n);
+  arr val(n);
+  n=0;
+  forEachEntry(A, [&](uint i, uint j, double v) { row.p[n]=i; col.p[n]=j; val.p[n]=v; n++; });
+
+  //-- radix sort by (row, col): counting sort by column, then (stable) by row
+  uintA count(d1+1), byCol(n), order(n);
+  count.setZero();
+  for(uint k=0; k<n; k++) count.p[col.p[k]+1]++;
+  for(uint j=0; j<d1; j++) count.p[j+1] += count.p[j];
+  for(uint k=0; k<n; k++) byCol.p[count.p[col.p[k]]++] = k;
+  count.resize(d0+1).setZero();
+  for(uint k=0; k<n; k++) count.p[row.p[k]+1]++;
+  for(uint i=0; i<d0; i++) count.p[i+1] += count.p[i];
+  for(uint t=0; t<n; t++) { uint k=byCol.p[t]; order.p[count.p[row.p[k]]++] = k; }
+
+  //-- compress, summing duplicates
+  rowPtr.resize(d0+1).setZero();
+  colIdx.resize(n);
+  vals.resize(n);
+  srcPos.resize(n);
+  uint m=0;
+  for(uint t=0; t<n; t++) {
+    uint k=order.p[t];
+    if(!m || row.p[k]!=row.p[order.p[t-1]] || col.p[k]!=colIdx.p[m-1]) {
+      colIdx.p[m] = col.p[k];
+      vals.p[m] = 0.;
+      rowPtr.p[row.p[k]+1]++;
+      m++;
+    }
+    vals.p[m-1] += val.p[k];
+    srcPos.p[k] = m-1;
+  }
+  for(uint i=0; i<d0; i++) rowPtr.p[i+1] += rowPtr.p[i];
+  colIdx.resizeCopy(m);
+  vals.resizeCopy(m);
+  if(sparse) srcElems = A.sparse().elems; else { srcElems.clear(); srcPos.clear(); }
+
+  setupCSC();
+  H_rowPtr.clear(); H_colIdx.clear(); H_elems.clear(); H_pos.clear();
+}
+
+void CSR::setupCSC() {
+  colPtr.resize(d1+1).setZero();
+  for(uint s=0; s<colIdx.N; s++) colPtr.p[colIdx.p[s]+1]++;
+  for(uint j=0; j<d1; j++) colPtr.p[j+1] += colPtr.p[j];
+  uintA next = colPtr;
+  rowIdx.resize(colIdx.N);
+  cscPos.resize(colIdx.N);
+  for(uint i=0; i<d0; i++) for(uint s=rowPtr.p[i]; s<rowPtr.p[i+1]; s++) {
+      uint t = next.p[colIdx.p[s]]++;
+      rowIdx.p[t] = i;
+      cscPos.p[t] = s;
+    }
+}
+
+arr CSR::A_x(const arr& x) const {
+  CHECK(x.nd<=2 && x.d0==d1, "A_x: dimension mismatch " <<x.dim() <<" vs " <<d1);
+  uint m = x.nd==1 ? 1 : x.d1; //x may be a matrix with m columns
+  arr y;
+  if(x.nd==1) y.resize(d0); else y.resize(d0, m);
+  y.setZero();
+  for(uint i=0; i<d0; i++) {
+    double* yi = y.p+i*m;
+    for(uint s=rowPtr.p[i]; s<rowPtr.p[i+1]; s++) {
+      double v = vals.p[s];
+      const double* xj = x.p+colIdx.p[s]*m;
+      for(uint c=0; c<m; c++) yi[c] += v*xj[c];
+    }
+  }
+  return y;
+}
+
+arr CSR::At_x(const arr& x) const {
+  CHECK(x.nd<=2 && x.d0==d0, "At_x: dimension mismatch " <<x.dim() <<" vs " <<d0);
+  uint m = x.nd==1 ? 1 : x.d1;
+  arr y;
+  if(x.nd==1) y.resize(d1); else y.resize(d1, m);
+  y.setZero();
+  for(uint i=0; i<d0; i++) {
+    const double* xi = x.p+i*m;
+    for(uint s=rowPtr.p[i]; s<rowPtr.p[i+1]; s++) {
+      double v = vals.p[s];
+      double* yj = y.p+colIdx.p[s]*m;
+      for(uint c=0; c<m; c++) yj[c] += v*xi[c];
+    }
+  }
+  return y;
+}
+
+arr CSR::At_A(const arr& w) {
+  if(!!w) CHECK_EQ(w.N, d0, "");
+
+  //-- symbolic phase (once per pattern): column i of A meets, via its rows r, all columns j>=i of these rows
+  if(H_rowPtr.N!=d1+1) {
+    H_rowPtr.resize(d1+1);
+    H_rowPtr.p[0]=0;
+    H_colIdx.clear();
+    uintA mark(d1);
+    for(uint& k:mark) k=UINT_MAX;
+    for(uint i=0; i<d1; i++) {
+      uint lo = H_colIdx.N;
+      for(uint t=colPtr.p[i]; t<colPtr.p[i+1]; t++) {
+        uint r = rowIdx.p[t];
+        for(uint s=cscPos.p[t]; s<rowPtr.p[r+1]; s++) { //the columns of row r are sorted: starting at column i
+          uint j = colIdx.p[s];
+          if(mark.p[j]!=i) { mark.p[j]=i; H_colIdx.append(j); }
+        }
+      }
+      std::sort(H_colIdx.p+lo, H_colIdx.p+H_colIdx.N);
+      H_rowPtr.p[i+1] = H_colIdx.N;
+    }
+    //the full symmetric output pattern
+    uint n=0;
+    for(uint i=0; i<d1; i++) for(uint u=H_rowPtr.p[i]; u<H_rowPtr.p[i+1]; u++) n += (H_colIdx.p[u]==i ? 1 : 2);
+    H_elems.resize(n, 2);
+    H_pos.resize(n);
+    n=0;
+    for(uint i=0; i<d1; i++) for(uint u=H_rowPtr.p[i]; u<H_rowPtr.p[i+1]; u++) {
+        uint j = H_colIdx.p[u];
+        H_elems.p[2*n]=i;  H_elems.p[2*n+1]=j;  H_pos.p[n++]=u;
+        if(j!=i) { H_elems.p[2*n]=j;  H_elems.p[2*n+1]=i;  H_pos.p[n++]=u; }
+      }
+  }
+
+  //-- numeric phase: row i of the upper triangle is accumulated densely, then gathered
+  arr acc = zeros(d1), upper(H_colIdx.N);
+  for(uint i=0; i<d1; i++) {
+    for(uint t=colPtr.p[i]; t<colPtr.p[i+1]; t++) {
+      uint r = rowIdx.p[t];
+      double a = vals.p[cscPos.p[t]];
+      if(!!w) a *= w.p[r];
+      if(!a) continue;
+      for(uint s=cscPos.p[t]; s<rowPtr.p[r+1]; s++) acc.p[colIdx.p[s]] += a*vals.p[s];
+    }
+    for(uint u=H_rowPtr.p[i]; u<H_rowPtr.p[i+1]; u++) {
+      double& h = acc.p[H_colIdx.p[u]];
+      upper.p[u] = h;
+      h = 0.;
+    }
+  }
+
+  arr H;
+  SparseMatrix& S = H.sparse();
+  S.reshape(d1, d1);
+  H.resizeMEM(H_pos.N, false);
+  S.elems = H_elems;
+  for(uint k=0; k<H_pos.N; k++) H.p[k] = upper.p[H_pos.p[k]];
+  return H;
+}
+
+CSR CSR::rowSlice(uint lo, uint hi) const {
+  CHECK(lo<=hi && hi<=d0, "");
+  CSR B;
+  B.d0=hi-lo;  B.d1=d1;
+  uint a=rowPtr.p[lo], b=rowPtr.p[hi];
+  B.rowPtr.resize(B.d0+1);
+  for(uint i=0; i<=B.d0; i++) B.rowPtr.p[i] = rowPtr.p[lo+i]-a;
+  B.colIdx.resize(b-a);
+  B.vals.resize(b-a);
+  if(b>a) {
+    memmove(B.colIdx.p, colIdx.p+a, B.colIdx.N*B.colIdx.sizeT);
+    memmove(B.vals.p, vals.p+a, B.vals.N*B.vals.sizeT);
+  }
+  B.setupCSC();
+  return B;
+}
+
+CSR CSR::colSlice(uint lo, uint hi) const {
+  CHECK(lo<=hi && hi<=d1, "");
+  CSR B;
+  B.d0=d0;  B.d1=hi-lo;
+  uint n=colPtr.p[hi]-colPtr.p[lo];
+  B.rowPtr.resize(d0+1);
+  B.colIdx.resize(n);
+  B.vals.resize(n);
+  B.rowPtr.p[0]=0;
+  n=0;
+  for(uint i=0; i<d0; i++) {
+    uint* c = std::lower_bound(colIdx.p+rowPtr.p[i], colIdx.p+rowPtr.p[i+1], lo);
+    for(uint s=c-colIdx.p; s<rowPtr.p[i+1] && colIdx.p[s]<hi; s++) {
+      B.colIdx.p[n] = colIdx.p[s]-lo;
+      B.vals.p[n] = vals.p[s];
+      n++;
+    }
+    B.rowPtr.p[i+1]=n;
+  }
+  B.setupCSC();
+  return B;
+}
+
+arr CSR::getSparse() const {
+  arr A;
+  SparseMatrix& S = A.sparse();
+  S.resize(d0, d1, vals.N);
+  for(uint i=0; i<d0; i++) for(uint s=rowPtr.p[i]; s<rowPtr.p[i+1]; s++) S.entry(i, colIdx.p[s], s) = vals.p[s];
+  return A;
+}
+
+arr CSR::unpack() const {
+  arr A = zeros(d0, d1);
+  for(uint i=0; i<d0; i++) for(uint s=rowPtr.p[i]; s<rowPtr.p[i+1]; s++) A.p[i*d1+colIdx.p[s]] = vals.p[s];
+  return A;
+}
+
+} //namespace
+
 //===========================================================================
 //
 // conv with Eigen
@@ -40,14 +40,62 @@ struct RowShifted;
 // OLD, TODO: hide -> array.cpp
 extern bool useLapack;
 extern const bool lapackSupported;
-extern uint64_t globalMemoryTotal, globalMemoryBound;
+
+//-- accounting of the memory held by Arrays
+
+/// subsystems whose Array memory is accounted separately (see MemoryTagScope)
+enum MemoryTag : unsigned char { MT_untagged=0, MT_KOMO, MT_Kin, MT_Perception, MT_numTags };
+
+/// lock-free accounting of the bytes allocated by all Arrays (M*sizeof(T)), per MemoryTag: each thread counts into its
+/// own slot (relaxed stores, no read-modify-write; exact when summed up); the high-water mark comes from batched
+/// per-thread updates and is accurate to ~64KB per thread. Converts to the current total (bytes).
+struct MemoryCounter {
+  uint64_t total() const;
+  uint64_t byTag(MemoryTag tag) const;
+  uint64_t peak() const;
+  void resetPeak();
+  operator uint64_t() const { return total(); }
+};
+extern MemoryCounter globalMemoryTotal;
+extern uint64_t globalMemoryBound; ///< soft cap on the total (0: none): exceeding it warns once, or throws if globalMemoryStrict
 extern bool globalMemoryStrict;
 
+/// while alive, Array memory newly allocated on this thread is accounted to tag (scopes nest)
+struct MemoryTagScope {
+  MemoryTag old;
+  MemoryTagScope(MemoryTag tag);
+  ~MemoryTagScope();
+};
+MemoryTag currentMemoryTag();
+MemoryTag accountMemory(int64_t bytes, int tag=-1); ///< called by Array::resizeMEM and freeMEM; tag=-1: the thread's current tag (returned)
+
 // default write formatting
 extern const char* arrayElemsep;
 extern const char* arrayLinesep;
 extern const char* arrayBrackets;
 
+/// opt-in scratch memory for the many short-lived arrays of elementary types (memMove==1, e.g. arr, uintA) in hot loops:
+/// while an ArenaScope is open on a thread, arrays on that thread that allocate memory for the first time draw it from a
+/// thread-local bump allocator instead of malloc; the allocator is reset when the outermost scope closes. Arrays that
+/// already hold heap memory (e.g. outputs allocated before the scope) stay on the heap. Arrays that outlive the scope
+/// remain valid: they keep their chunk alive (which is then retired and freed with the last of them). Hence long-lived
+/// members first allocated inside a scope (e.g. caches kept across optimizer iterations) pin a whole chunk each: allocate
+/// them under an ArenaPause
+struct ArenaScope {
+  static uint64_t chunkSize; ///< bytes per chunk; requests above chunkSize/4 go to the heap
+  bool active;
+  ArenaScope(bool active=true); ///< inactive scopes do nothing (to make the arena a runtime option)
+  ~ArenaScope();
+};
+/// suspends the open ArenaScopes of this thread: arrays allocated meanwhile go to the heap
+struct ArenaPause {
+  uint depth;
+  ArenaPause();
+  ~ArenaPause();
+};
+void* arenaMalloc(uint64_t size); ///< NULL if no scope is open on this thread or size is too large
+void arenaFree(void* p);
+
 // default sorting methods
 template<class T> bool lower(const T& a, const T& b) { return a<b; }
 template<class T> bool lowerEqual(const T& a, const T& b) { return a<=b; }
@@ -66,6 +114,7 @@ namespace rai {
 template<class T> struct ArrayIterationEnumerated;
 template<class T> struct ArrayIterationReverse;
 template<class T> struct ArrayModRaw;
+template<class T, uint D0, uint D1> struct FixedArray;
 
 /** Simple array container to store arbitrary-dimensional arrays (tensors).
   Can buffer more memory than necessary for faster
@@ -82,6 +131,8 @@ template<class T> struct Array : /*std::vector<T>,*/ Serializable {
   uint d0, d1, d2; ///< 0th, 1st, 2nd dim
   uint* d;  ///< pointer to dimensions (for nd<=3 points to d0)
   bool isReference; ///< true if this refers to memory of another array
+  bool isArena;     ///< true if the memory was drawn from the scratch arena (see ArenaScope)
+  unsigned char memTag; ///< the MemoryTag the memory is accounted to
   uint M;   ///< memory allocated (>=N)
 
   static int  sizeT;   ///< constant for each type T: stores the sizeof(T)
@@ -158,6 +209,7 @@ template<class T> struct Array : /*std::vector<T>,*/ Serializable {
   void setDiag(const Array<T>& vector);
   void setVectorBlock(const Array<T>& B, uint lo);
   void setMatrixBlock(const Array<T>& B, uint lo0, uint lo1);
+  template<uint D0, uint D1> void setMatrixBlock(const FixedArray<T, D0, D1>& B, uint lo0, uint lo1) { setMatrixBlock(B.noCopy(), lo0, lo1); }
   //TODO setTensorBlock(const Array<T>& B, const Array<uint>& lo);
   void setBlockMatrix(const Array<T>& A, const Array<T>& B, const Array<T>& C, const Array<T>& D);
   void setBlockMatrix(const Array<T>& A, const Array<T>& B);
@@ -473,6 +525,57 @@ BinaryFunction(fmod);
 #undef BinaryFunction
 
 
+//===========================================================================
+/// @}
+/// @name fixed-size arrays
+/// @{
+
+namespace rai {
+
+/// compile-time sized D0 x D1 matrix (D1=1: a column) with storage on the stack, e.g. for the 3x3 and 3x4 blocks of
+/// Jacobian kernels: row-major like Array, fixed loop bounds (which the compiler unrolls), and noCopy() as a non-owning
+/// (2D) Array view to interoperate with Arrays (setMatrixBlock, operators, printing)
+template<class T, uint D0, uint D1=1> struct FixedArray {
+  T p[D0*D1];
+  static constexpr uint N=D0*D1, d0=D0, d1=D1;
+
+  T& operator()(uint i) { return p[i]; }
+  const T& operator()(uint i) const { return p[i]; }
+  T& operator()(uint i, uint j) { return p[i*D1+j]; }
+  const T& operator()(uint i, uint j) const { return p[i*D1+j]; }
+
+  FixedArray& setZero() { for(uint i=0; i<N; i++) p[i]=T(0);  return *this; }
+  FixedArray& operator*=(T z) { for(uint i=0; i<N; i++) p[i]*=z;  return *this; }
+  FixedArray& operator/=(T z) { for(uint i=0; i<N; i++) p[i]/=z;  return *this; }
+  FixedArray& operator+=(const FixedArray& x) { for(uint i=0; i<N; i++) p[i]+=x.p[i];  return *this; }
+  FixedArray& operator-=(const FixedArray& x) { for(uint i=0; i<N; i++) p[i]-=x.p[i];  return *this; }
+
+  /// matrix product
+  template<uint D2> FixedArray<T, D0, D2> operator*(const FixedArray<T, D1, D2>& B) const {
+    FixedArray<T, D0, D2> C;
+    for(uint i=0; i<D0; i++) for(uint k=0; k<D2; k++) {
+        T s=T(0);
+        for(uint j=0; j<D1; j++) s += p[i*D1+j]*B.p[j*D2+k];
+        C.p[i*D2+k]=s;
+      }
+    return C;
+  }
+
+  /// the columns [lo, lo+D) (e.g. the first two columns of a rotation matrix)
+  template<uint D> FixedArray<T, D0, D> cols(uint lo) const {
+    FixedArray<T, D0, D> C;
+    for(uint i=0; i<D0; i++) for(uint j=0; j<D; j++) C.p[i*D+j]=p[i*D1+lo+j];
+    return C;
+  }
+
+  /// a reference (no copy, no allocation) -- valid only as long as this lives
+  Array<T> noCopy() const { Array<T> x(p, N, true);  x.reshape(D0, D1);  return x; }
+  /// a copy as (heap) Array
+  Array<T> getArr() const { Array<T> x(p, N, false);  x.reshape(D0, D1);  return x; }
+};
+
+} //namespace
+
 //===========================================================================
 /// @}
 /// @name standard types
@@ -493,6 +596,7 @@ typedef rai::Array<arr*>   arrL;
 typedef rai::Array<arr>    arrA;
 typedef rai::Array<intA>   intAA;
 typedef rai::Array<uintA>  uintAA;
+typedef rai::FixedArray<double, 3, 3> arr33;
 
 namespace rai { struct String; }
 typedef rai::Array<rai::String> StringA;
@@ -1045,6 +1149,53 @@ struct SparseMatrix : SpecialArray {
   void checkConsistency() const;
 };
 
+/// compressed sparse row (CSR) layout of a matrix, converted from a dense, sparse (SparseMatrix) or row-shifted array for
+/// cache-friendly products: the non-zeros of row i are colIdx/vals[rowPtr(i)..rowPtr(i+1)-1], sorted by column, with
+/// duplicate entries summed. The column-wise (CSC) order is kept alongside for products with A^T. Keep a CSR object alive
+/// across calls: if a SparseMatrix keeps its sparsity pattern (elems), set() and At_A() only redo the numeric part
+struct CSR {
+  uint d0=0, d1=0;
+  uintA rowPtr;  ///< d0+1 offsets into colIdx and vals
+  uintA colIdx;  ///< column of each non-zero
+  arr vals;      ///< value of each non-zero
+  uintA colPtr;  ///< d1+1 offsets into rowIdx and cscPos (CSC order)
+  uintA rowIdx;  ///< row of each non-zero in CSC order
+  uintA cscPos;  ///< CSR index of each non-zero in CSC order
+
+  CSR() {}
+  CSR(const arr& A) { set(A); }
+  void set(const arr& A);
+  //computations
+  arr A_x(const arr& x) const;
+  arr At_x(const arr& x) const;
+  arr At_A(const arr& w=NoArr); ///< A^T diag(w) A (w=NoArr: A^T A) as SparseMatrix; only the upper triangle is computed
+  //slicing and conversion
+  CSR rowSlice(uint lo, uint hi) const; ///< rows lo..hi-1
+  CSR colSlice(uint lo, uint hi) const; ///< columns lo..hi-1
+  arr getSparse() const;
+  arr unpack() const;
+
+  //cached patterns (cleared whenever the pattern of A changes)
+  intA srcElems;            ///< sparsity pattern of the SparseMatrix last set from
+  uintA srcPos;             ///< CSR index of each of its non-zeros
+  uintA H_rowPtr, H_colIdx; ///< pattern of the upper triangle of A^T A
+  intA H_elems;             ///< full symmetric pattern of A^T A, in output memory order
+  uintA H_pos;              ///< index in the upper triangle of each output non-zero
+  void setupCSC();
+};
+
+/// sparse LDLT solver for symmetric pos-def matrices (SparseMatrix), which keeps its symbolic analysis (fill-reducing ordering,
+/// elimination tree) as long as the sparsity pattern of A does not change; the diagonal shift (e.g. Levenberg damping) is
+/// only added within the numeric factorization and can be changed without re-analysis
+struct SparseCholesky {
+  std::unique_ptr<struct sSparseCholesky> self;
+  uint analyzeCount=0, factorizeCount=0; ///< counts how often the symbolic and numeric phases were run
+
+  SparseCholesky();
+  ~SparseCholesky();
+  arr solve(const arr& A, const arr& b, double shift=0.); ///< returns x=(A + shift*I)^{-1} b; throws if A + shift*I is not pos-def
+};
+
 arr unpack(const arr& X);
 arr comp_At_A(const arr& A);
 arr comp_A_At(const arr& A);
@@ -1053,6 +1204,43 @@ arr comp_At(const arr& A);
 arr comp_A_x(const arr& A, const arr& x);
 arr makeRowSparse(const arr& X);
 
+//===========================================================================
+/// @name forward-mode autodiff
+// An arr x may carry x.jac, the Jacobian of its (flattened) entries w.r.t. some parameter theta (x.N rows), stored
+// dense, sparse (SparseMatrix) or row-shifted (RowShifted). theta.diff_setId() starts the differentiation; the
+// arithmetic operators, products (*, %, ^, crossProduct), unary functions (sin, exp, sqrt..), transpose, sub-ranges
+// x({i,j}), x[i] and append propagate it, and so do the reductions below. Sparse Jacobians stay sparse (row-shifted
+// ones become sparse when rows are mixed), so that KOMO features keep their sparsity. Operations that do not support
+// it HALT rather than silently dropping the Jacobian. Only for double.
+//
+
+arr diff_sum(const arr& x);                          ///< {sum(x)}
+arr diff_sumOfSqr(const arr& x);                     ///< {sumOfSqr(x)}
+arr diff_length(const arr& x);                       ///< {length(x)}
+arr diff_scalarProduct(const arr& x, const arr& y);  ///< {scalarProduct(x, y)}
+void diff_chain(arr& y, const arr& J, const arr& x); ///< y.jac += J * x.jac: chain rule for functions with a hand-coded Jacobian J
+
+//-- Jacobian kernels (any mix of dense, sparse and row-shifted)
+void jac_add(std::unique_ptr<arr>& J, const arr& B, double coeff=1.); ///< J += coeff*B (J may be null)
+arr jac_rowMap(const arr& B, uint d0, const uintA& dst, const uintA& src, const arr& w); ///< d0 rows: row dst(k) += w(k) * row src(k) of B
+
+//-- used by the operators: set x.jac after the value of x was computed (diff_update: before x is updated)
+void diff_binary(arr& x, const arr& y, const arr& z, char op); ///< op: '*' inner, '%' index-wise, '^' outer, '.' elem-wise, 'x' cross product
+void diff_update(arr& x, const arr& y, char op);               ///< x op= y
+void diff_update(arr& x, double y, char op);
+void diff_transpose(arr& x, const arr& y);
+void diff_range(arr& x, const arr& y, uint lo);                ///< x refers to y.p[lo..]
+void diff_append(arr& x, const arr& y, uint oldN);             ///< y was appended to the first oldN entries of x
+template<class T> void diff_binary(Array<T>& x, const Array<T>& y, const Array<T>& z, char op); //(NIY for T!=double)
+template<class T> void diff_update(Array<T>& x, const Array<T>& y, char op);
+template<class T> void diff_update(Array<T>& x, T y, char op);
+template<class T> void diff_transpose(Array<T>& x, const Array<T>& y);
+template<class T> void diff_range(Array<T>& x, const Array<T>& y, uint lo);
+template<class T> void diff_append(Array<T>& x, const Array<T>& y, uint oldN);
+
+/// y itself, or a reference to it without its Jacobian (to compute the value of an operation before its Jacobian)
+template<class T> const Array<T>& diff_value(Array<T>& ref, const Array<T>& y) { if(!y.jac) return y; ref.referTo(y); return ref; }
+
 }//namespace rai
 
 #define UpdateOperator( op ) \
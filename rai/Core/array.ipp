@@ -61,6 +61,8 @@ template<class T> rai::Array<T>::Array()
     d0(0), d1(0), d2(0),
     d(&d0),
     isReference(false),
+    isArena(false),
+    memTag(MT_untagged),
     M(0),
     special(0) {
   if(sizeT==-1) sizeT=sizeof(T);
@@ -92,13 +94,26 @@ template<class T> rai::Array<T>::Array(rai::Array<T>&& a)
     d0(a.d0), d1(a.d1), d2(a.d2),
     d(&d0),
     isReference(a.isReference),
+    isArena(a.isArena),
+    memTag(a.memTag),
     M(a.M),
-    special(a.special) {
+    special(a.special),
+    jac(std::move(a.jac)) {
   CHECK_EQ(a.d, &a.d0, "");
   a.p=NULL;
-  a.N=a.nd=a.d0=a.d1=a.d2=0;
-  a.isReference=false;
+  a.N=a.nd=a.d0=a.d1=a.d2=a.M=0;
+  a.isReference=a.isArena=false;
   a.special=NULL;
+  if(special && (special->type==SpecialArray::RowShiftedST || special->type==SpecialArray::sparseMatrixST || special->type==SpecialArray::sparseVectorST)) {
+    //the special data refers to a: rebuild it for this
+    SpecialArray* s=special;
+    special=NULL;
+    CHECK(typeid(T) == typeid(double), "");
+    if(s->type==SpecialArray::RowShiftedST) new RowShifted(*((arr*)this), *dynamic_cast<RowShifted*>(s));
+    else if(s->type==SpecialArray::sparseVectorST) new SparseVector(*((arr*)this), *dynamic_cast<SparseVector*>(s));
+    else new SparseMatrix(*((arr*)this), *dynamic_cast<SparseMatrix*>(s));
+    delete s;
+  }
 }
 
 /// constructor with resize
@@ -460,9 +475,18 @@ template<class T> void rai::Array<T>::resizeMEM(uint n, bool copy, int Mforce) {
   CHECK_GE(Mnew, n, "");
   CHECK((p && M) || (!p && !M), "");
   if(Mnew!=Mold) {  //if M changed, allocate the memory
+    memTag = accountMemory(int64_t(Mnew)*sizeT - int64_t(Mold)*sizeT, Mold ? memTag : -1); //(throws if the strict bound is exceeded)
     if(Mnew) {
         if(memMove==1){
-            if(p){
+            if(!p && (p=(T*)arenaMalloc(Mnew*sizeT))) { //fresh memory while an ArenaScope is open
+                isArena=true;
+            } else if(isArena) { //grow or shrink an arena array: into the arena if possible, otherwise to the heap
+                T* pold = p;
+                p=(T*)arenaMalloc(Mnew*sizeT);
+                if(!p) { p=(T*)malloc(Mnew*sizeT);  isArena=false; }
+                if(p) memmove(p, pold, sizeT*(N<n?N:n));
+                arenaFree(pold);
+            } else if(p){
                 p=(T*)realloc(p, Mnew*sizeT);
             } else {
                 p=(T*)malloc(Mnew*sizeT);
@@ -480,7 +504,8 @@ template<class T> void rai::Array<T>::resizeMEM(uint n, bool copy, int Mforce) {
     } else {
       if(p) {
           if(memMove==1){
-              free(p);
+              if(isArena) arenaFree(p); else free(p);
+              isArena=false;
           }else{
               delete[] p;
           }
@@ -500,8 +525,9 @@ template<class T> void rai::Array<T>::freeMEM() {
   vec_type::clear();
 #else
   if(M) {
+      accountMemory(-int64_t(M)*sizeT, memTag);
       if(memMove==1){
-          free(p);
+          if(isArena) arenaFree(p); else free(p);
       }else{
           delete[] p;
       }
@@ -513,7 +539,7 @@ template<class T> void rai::Array<T>::freeMEM() {
   p=NULL;
   N=nd=d0=d1=d2=0;
   d=&d0;
-  isReference=false;
+  isReference=isArena=false;
 }
 #endif
 
@@ -551,6 +577,7 @@ template<class T> T& rai::Array<T>::append() {
 
 /// append an element to the array -- the array becomes 1D!
 template<class T> T& rai::Array<T>::append(const T& x) {
+  CHECK(!jac, "AutoDiff NIY: append a differentiable array instead");
 #if 0
   reshape(N);
   vec_type::push_back(x);
@@ -586,6 +613,7 @@ template<class T> void rai::Array<T>::append(const rai::Array<T>& x) {
     resizeCopy(N+xN);
   if(memMove==1) memmove(p+oldN, x.p, sizeT*xN);
   else for(i=0; i<xN; i++) p[oldN+i]=x.p[i];
+  if(jac || x.jac) diff_append(*this, x, oldN);
 }
 
 /// append a C array to the array (by copying it) -- the array might become 1D!
@@ -941,6 +969,7 @@ template<class T> rai::Array<T> rai::Array<T>::ref() const {
 template<class T> rai::Array<T> rai::Array<T>::operator()(std::pair<int, int> I) const {
   rai::Array<T> z;
   z.referToRange(*this, I.first, I.second);
+  if(jac) diff_range(z, *this, z.p-p);
   //  if(I.size()==2) z.referToRange(*this, I.begin()[0], I.begin()[1]);
   //  else if(I.size()==0) z.referTo(*this);
   //  else if(I.size()==1) z.referToDim(*this, I.begin()[0]);
@@ -952,6 +981,7 @@ template<class T> rai::Array<T> rai::Array<T>::operator()(std::pair<int, int> I)
 template<class T> rai::Array<T> rai::Array<T>::operator()(int i, std::pair<int, int> J) const {
   rai::Array<T> z;
   z.referToRange(*this, i, J.first, J.second);
+  if(jac) diff_range(z, *this, z.p-p);
 //  if(J.size()==2)
 //  else if(J.size()==0) z.referToDim(*this, i);
 //  else if(J.size()==1) z.referToDim(*this, i, J.begin()[0]);
@@ -982,6 +1012,7 @@ template<class T> rai::Array<T> rai::Array<T>::operator[](int i) const {
 //  return Array(*this, i);
   rai::Array<T> z;
   z.referToDim(*this, i);
+  if(jac) diff_range(z, *this, z.p-p);
   return z;
 }
 
@@ -1355,6 +1386,7 @@ template<class T> rai::Array<T>& rai::Array<T>::operator=(const rai::Array<T>& a
     } else NIY;
   }
   if(a.jac) jac = make_unique<rai::Array<T>>(*a.jac);
+  else jac.reset();
   return *this;
 }
 
@@ -1744,8 +1776,9 @@ template<class T> void rai::Array<T>::takeOver(rai::Array<T>& a) {
   freeMEM();
   memMove=a.memMove;
   N=a.N; nd=a.nd; d0=a.d0; d1=a.d1; d2=a.d2;
-  p=a.p; M=a.M;
+  p=a.p; M=a.M; isArena=a.isArena; memTag=a.memTag;
   a.isReference=true;
+  a.isArena=false;
   a.M=0;
 }
 
@@ -1759,6 +1792,9 @@ template<class T> void rai::Array<T>::swap(Array<T>& a) {
 
 #define SWAPx(X, Y){ auto z=X; X=Y; Y=z; }
   SWAPx(p, a.p);
+  SWAPx(isArena, a.isArena);
+  SWAPx(memTag, a.memTag);
+  jac.swap(a.jac);
 //  SWAPx(special, a.special);
 //  SWAPx(isReference, a.isReference);
 //  T* p_tmp = p;
@@ -2274,7 +2310,12 @@ template<class T> const char* rai::Array<T>::prt() {
 
 /// x = y^T
 template<class T> void op_transpose(rai::Array<T>& x, const rai::Array<T>& y) {
-  if(y.jac){ NIY }
+  if(y.jac) {
+    rai::Array<T> y0;
+    op_transpose(x, diff_value(y0, y));
+    diff_transpose(x, y);
+    return;
+  }
   CHECK(&x!=&y, "can't transpose matrix into itself");
   CHECK_LE(y.nd, 3, "can only transpose up to 3D arrays");
   if(y.nd==3) {
@@ -2798,6 +2839,12 @@ template<class T> T product(const rai::Array<T>& v) {
 template<class T>
 void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<T>& z) {
   if(!y || !z){ x.setNoArr(); return; }
+  if(y.jac || z.jac) { //the value without Jacobians, then the Jacobian
+    rai::Array<T> y0, z0;
+    op_innerProduct(x, diff_value(y0, y), diff_value(z0, z));
+    diff_binary(x, y, z, '*');
+    return;
+  }
   /*
     if(y.nd==2 && z.nd==2 && y.N==z.N && y.d1==1 && z.d1==1){  //elem-wise
     HALT("make element-wise multiplication explicite!");
@@ -2819,10 +2866,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
       for(; a!=astop; a++, b++)(*c)+=(*a) * (*b);
       c++;
     }
-    if(z.jac){
-      x.jac = make_unique<rai::Array<T>>();
-      *x.jac = y*(*z.jac);
-    }
     return;
   }
   if(y.nd==2 && z.nd==2) {  //plain matrix multiplication
@@ -2857,14 +2900,12 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
         for(; a!=astop; a++, b+=d1)(*c)+=(*a) * (*b);
         c++;
       }
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==1 && z.N==1) {  //vector multiplied with scalar (disguised as 1D vector)
     uint k, dk=y.N;
     x.resize(y.N);
     for(k=0; k<dk; k++) x.p[k]=y.p[k]*z.p[0];
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==2 && z.d0==1) {  //vector x vector^T -> matrix (outer product)
@@ -2877,7 +2918,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
     uint i, j, d0=y.d0, d1=z.d1;
     x.resize(d0, d1);
     for(i=0; i<d0; i++) for(j=0; j<d1; j++) x(i, j)=y(i)*z(0, j);
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==2) {  //vector^T x matrix -> vector^T
@@ -2893,7 +2933,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
     zz.reshape(z.d0, z.d1*z.d2);
     op_innerProduct(x, y, zz);
     x.reshape(y.d0, z.d1, z.d2);
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==3 && z.nd==2) {
@@ -2901,7 +2940,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
     yy.reshape(y.d0*y.d1, y.d2);
     op_innerProduct(x, yy, z);
     x.reshape(y.d0, y.d1, z.d1);
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==3 && z.nd==1) {
@@ -2909,7 +2947,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
     yy.reshape(y.d0*y.d1, y.d2);
     op_innerProduct(x, yy, z);
     x.reshape(y.d0, y.d1);
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==3) {
@@ -2917,7 +2954,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
     zz.reshape(z.d0, z.d1*z.d2);
     op_innerProduct(x, y, zz);
     x.reshape(z.d1, z.d2);
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==1) {  //should be scalar product, but be careful
@@ -2928,7 +2964,6 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
     T s;
     for(s=0, k=0; k<dk; k++) s+=y.p[k]*z.p[k];
     x.p[0]=s;
-    if(y.jac || z.jac){ NIY }
     return;
   }
   HALT("inner product - not yet implemented for these dimensions: " <<y.nd <<" " <<z.nd);
@@ -2938,6 +2973,12 @@ void op_innerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
   x_{ijk} = v_{ij}\, w_{k}\f$ */
 template<class T>
 void op_outerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<T>& z) {
+  if(y.jac || z.jac) { //the value without Jacobians, then the Jacobian
+    rai::Array<T> y0, z0;
+    op_outerProduct(x, diff_value(y0, y), diff_value(z0, z));
+    diff_binary(x, y, z, '^');
+    return;
+  }
   if(y.nd==1 && z.nd==1) {
 #if 1
     uint i, j, d0=y.d0, d1=z.d0;
@@ -2953,14 +2994,12 @@ void op_outerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
       for(; zp!=zstop; zp++, xp++) *xp = yi * *zp;
     }
 #endif
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==2 && z.nd==1) {
     uint i, j, k, d0=y.d0, d1=y.d1, d2=z.d0;
     x.resize(d0, d1, d2);
     for(i=0; i<d0; i++) for(j=0; j<d1; j++) for(k=0; k<d2; k++) x.p[(i*d1+j)*d2+k] = y.p[i*d1+j] * z.p[k];
-    if(y.jac || z.jac){ NIY }
     return;
   }
   HALT("outer product - not yet implemented for these dimensions");
@@ -2970,9 +3009,14 @@ void op_outerProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<
 template<class T>
 void op_elemWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<T>& z) {
   CHECK_EQ(y.N, z.N, "");
+  if(y.jac || z.jac) { //the value without Jacobians, then the Jacobian
+    rai::Array<T> y0, z0;
+    op_elemWiseProduct(x, diff_value(y0, y), diff_value(z0, z));
+    diff_binary(x, y, z, '.');
+    return;
+  }
   x = z;
   for(uint i=0; i<x.N; i++) x.elem(i) *= y.elem(i);
-  if(y.jac || z.jac){ NIY }
   return;
 }
 
@@ -2982,16 +3026,20 @@ void op_elemWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Arr
   \f$\forall_{i}:~ x_{ij} = v_{ij} w_{ij}\f$*/
 template<class T>
 void op_indexWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<T>& z) {
+  if(y.jac || z.jac) { //the value without Jacobians, then the Jacobian
+    rai::Array<T> y0, z0;
+    op_indexWiseProduct(x, diff_value(y0, y), diff_value(z0, z));
+    diff_binary(x, y, z, '%');
+    return;
+  }
   if(y.N==1) { //scalar x any -> ..
     x=z;
     x*=y.scalar();
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==1) {  //vector x vector -> element wise
     x=y;
     x*=z;
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==1 && z.nd==2) {  //vector x matrix -> index-wise
@@ -3000,7 +3048,6 @@ void op_indexWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Ar
     if(isSparseMatrix(z)){
       CHECK(typeid(T)==typeid(double), "only for double!");
       x.sparse().rowWiseMult(y);
-      if(y.jac || z.jac){ NIY }
       return;
     }
     if(isRowShifted(z)){
@@ -3012,7 +3059,6 @@ void op_indexWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Ar
         double *xstop=xp+rowSize;
         for(; xp!=xstop; xp++) *xp *= yi;
       }
-      if(y.jac || z.jac){ NIY }
       return;
     }
     for(uint i=0; i<x.d0; i++) {
@@ -3020,14 +3066,12 @@ void op_indexWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Ar
       T* xp=&x(i, 0), *xstop=xp+x.d1;
       for(; xp!=xstop; xp++) *xp *= yi;
     }
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==2 && z.nd==1) {  //matrix x vector -> index-wise
     CHECK_EQ(y.d1, z.N, "wrong dims for indexWiseProduct:" <<y.d1 <<"!=" <<z.N);
     x=y;
     for(uint i=0; i<x.d0; i++) for(uint j=0; j<x.d1; j++) x(i, j) *= z(j);
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.dim() == z.dim()) { //matrix x matrix -> element-wise
@@ -3035,7 +3079,6 @@ void op_indexWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Ar
     x = y;
     T* xp=x.p, *xstop=x.p+x.N, *zp=z.p;
     for(; xp!=xstop; xp++, zp++) *xp *= *zp;
-    if(y.jac || z.jac){ NIY }
     return;
   }
   HALT("operator% not implemented for "<<y.dim() <<" %" <<z.dim() <<" [I would like to change convention on the interpretation of operator% - contact Marc!")
@@ -3046,19 +3089,23 @@ void op_indexWiseProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Ar
 template<class T>
 void op_crossProduct(rai::Array<T>& x, const rai::Array<T>& y, const rai::Array<T>& z) {
   if(!y || !z){ x.setNoArr(); return; }
+  if(y.jac || z.jac) { //the value without Jacobians, then the Jacobian
+    rai::Array<T> y0, z0;
+    op_crossProduct(x, diff_value(y0, y), diff_value(z0, z));
+    diff_binary(x, y, z, 'x');
+    return;
+  }
   if(y.nd==1 && z.nd==1) {
     CHECK(y.N==3 && z.N==3, "cross product only works for 3D vectors!");
     x.resize(3);
     x.p[0]=y.p[1]*z.p[2]-y.p[2]*z.p[1];
     x.p[1]=y.p[2]*z.p[0]-y.p[0]*z.p[2];
     x.p[2]=y.p[0]*z.p[1]-y.p[1]*z.p[0];
-    if(y.jac || z.jac){ NIY }
     return;
   }
   if(y.nd==2 && z.nd==1) { //every COLUMN of y is cross-product'd with z!
     CHECK(y.d0==3 && z.N==3, "cross product only works for 3D vectors!");
     x = skew(-z) * y;
-    if(y.jac || z.jac){ NIY }
     return;
   }
   HALT("cross product - not yet implemented for these dimensions");
@@ -3827,7 +3874,7 @@ template<class T> Array<T>& operator<<(Array<T>& x, const T& y) { x.append(y); r
 template<class T> Array<T>& operator<<(Array<T>& x, const Array<T>& y) { x.append(y); return x; }
 
 
-#define UpdateOperator( op )        \
+#define UpdateOperator( op, opChar )        \
   template<class T> Array<T>& operator op (Array<T>& x, const Array<T>& y){ \
     if(isNoArr(x)){ return x; } \
     if(isSparseMatrix(x) && isSparseMatrix(y)){ x.sparse() op y.sparse(); return x; }  \
@@ -3835,6 +3882,7 @@ template<class T> Array<T>& operator<<(Array<T>& x, const Array<T>& y) { x.appen
     CHECK(!isSpecial(x), "");  \
     CHECK(!isSpecial(y), "");  \
     CHECK_EQ(x.N, y.N, "binary operator on different array dimensions (" <<x.N <<", " <<y.N <<")"); \
+    if(x.jac || y.jac) diff_update(x, y, opChar); \
     T *xp=x.p, *xstop=xp+x.N;              \
     const T *yp=y.p;              \
     for(; xp!=xstop; xp++, yp++) *xp op *yp;       \
@@ -3846,6 +3894,7 @@ template<class T> Array<T>& operator<<(Array<T>& x, const Array<T>& y) { x.appen
     if(isSparseMatrix(x)){ x.sparse() op y; return x; }  \
     if(isRowShifted(x)){ x.rowShifted() op y; return x; }  \
     CHECK(!isSpecial(x), "");  \
+    if(x.jac) diff_update(x, y, opChar); \
     T *xp=x.p, *xstop=xp+x.N;              \
     for(; xp!=xstop; xp++) *xp op y;        \
     return x;           \
@@ -3871,14 +3920,14 @@ template<class T> Array<T>& operator<<(Array<T>& x, const Array<T>& y) { x.appen
     for(; xp!=xstop; xp++) *xp op y;        \
   }
 
-UpdateOperator(|=)
-UpdateOperator(^=)
-UpdateOperator(&=)
-UpdateOperator(+=)
-UpdateOperator(-=)
-UpdateOperator(*=)
-UpdateOperator(/=)
-UpdateOperator(%=)
+UpdateOperator(|=, '|')
+UpdateOperator(^=, '^')
+UpdateOperator(&=, '&')
+UpdateOperator(+=, '+')
+UpdateOperator(-=, '-')
+UpdateOperator(*=, '*')
+UpdateOperator(/=, '/')
+UpdateOperator(%=, '%')
 #undef UpdateOperator
 
 #define BinaryOperator( op, updateOp)         \
@@ -3979,49 +4028,54 @@ inline double sigm(double x) {  return 1./(1.+::exp(-x)); }
 
 inline double sign(double x) {  return (x > 0) - (x < 0); }
 
-#define UnaryFunction( func )         \
+/// elementwise function; deriv is its derivative in terms of the argument v and the value f (for autodiff)
+#define UnaryFunction( func, deriv )         \
   template<class T>           \
   rai::Array<T> func (const rai::Array<T>& y){    \
     rai::Array<T> x;           \
     if(&x!=&y) x.resizeAs(y);         \
     T *xp=x.p, *xstop=xp+x.N, *yp=y.p;            \
     for(; xp!=xstop; xp++, yp++) *xp = (T)::func( (double) *yp );  \
-    CHECK(!y.jac, "AutoDiff NIY"); \
+    if(y.jac){ \
+      rai::Array<T> g(y.N); \
+      for(uint i=0; i<y.N; i++){ double v=y.p[i], f=x.p[i]; (void)v; (void)f; g.p[i] = (T)(deriv); } \
+      x.jac = make_unique<rai::Array<T>>(g % *y.jac); \
+    } \
     return x;         \
   }
 
 // trigonometric functions
-UnaryFunction(acos);
-UnaryFunction(asin);
-UnaryFunction(atan);
-UnaryFunction(cos);
-UnaryFunction(sin);
-UnaryFunction(tan);
+UnaryFunction(acos, -1./::sqrt(1.-v*v));
+UnaryFunction(asin, 1./::sqrt(1.-v*v));
+UnaryFunction(atan, 1./(1.+v*v));
+UnaryFunction(cos, -::sin(v));
+UnaryFunction(sin, ::cos(v));
+UnaryFunction(tan, 1.+f*f);
 
 // hyperbolic functions
-UnaryFunction(cosh);
-UnaryFunction(sinh);
-UnaryFunction(tanh);
-UnaryFunction(acosh);
-UnaryFunction(asinh);
-UnaryFunction(atanh);
+UnaryFunction(cosh, ::sinh(v));
+UnaryFunction(sinh, ::cosh(v));
+UnaryFunction(tanh, 1.-f*f);
+UnaryFunction(acosh, 1./::sqrt(v*v-1.));
+UnaryFunction(asinh, 1./::sqrt(v*v+1.));
+UnaryFunction(atanh, 1./(1.-v*v));
 
 // exponential and logarithmic functions
-UnaryFunction(exp);
-UnaryFunction(log);
-UnaryFunction(log10);
+UnaryFunction(exp, f);
+UnaryFunction(log, 1./v);
+UnaryFunction(log10, 1./(v*M_LN10));
 
 //roots
-UnaryFunction(sqrt);
-UnaryFunction(cbrt);
+UnaryFunction(sqrt, .5/f);
+UnaryFunction(cbrt, 1./(3.*f*f));
 
 // nearest integer and absolute value
-UnaryFunction(ceil);
-UnaryFunction(fabs);
-UnaryFunction(floor);
-UnaryFunction(sigm);
+UnaryFunction(ceil, 0.);
+UnaryFunction(fabs, sign(v));
+UnaryFunction(floor, 0.);
+UnaryFunction(sigm, f*(1.-f));
 
-UnaryFunction(sign);
+UnaryFunction(sign, 0.);
 
 #undef UnaryFunction
 
@@ -4032,6 +4086,7 @@ UnaryFunction(sign);
   rai::Array<T> func(const rai::Array<T>& y, const rai::Array<T>& z){ \
     CHECK_EQ(y.N,z.N,             \
              "binary operator on different array dimensions (" <<y.N <<", " <<z.N <<")"); \
+    CHECK(!y.jac && !z.jac, "AutoDiff NIY"); \
     rai::Array<T> x;             \
     x.resizeAs(y);              \
     for(uint i=x.N;i--; ) x.p[i]= func(y.p[i], z.p[i]);      \
@@ -4040,6 +4095,7 @@ UnaryFunction(sign);
   \
   template<class T>             \
   rai::Array<T> func(const rai::Array<T>& y, T z){     \
+    CHECK(!y.jac, "AutoDiff NIY"); \
     rai::Array<T> x;             \
     x.resizeAs(y);              \
     for(uint i=x.N;i--; ) x.p[i]= func(y.p[i], z);     \
@@ -4048,6 +4104,7 @@ UnaryFunction(sign);
   \
   template<class T>             \
   rai::Array<T> func(T y, const rai::Array<T>& z){     \
+    CHECK(!z.jac, "AutoDiff NIY"); \
     rai::Array<T> x;             \
     x.resizeAs(z);              \
     for(uint i=x.N;i--; ) x.p[i]= func(y, z.p[i]);     \
@@ -4106,6 +4163,15 @@ void rai::Array<T>::diff_setId() {
   jac->setId(N);
 }
 
+namespace rai {
+template<class T> void diff_binary(Array<T>& x, const Array<T>& y, const Array<T>& z, char op) { NIY }
+template<class T> void diff_update(Array<T>& x, const Array<T>& y, char op) { NIY }
+template<class T> void diff_update(Array<T>& x, T y, char op) { NIY }
+template<class T> void diff_transpose(Array<T>& x, const Array<T>& y) { NIY }
+template<class T> void diff_range(Array<T>& x, const Array<T>& y, uint lo) { NIY }
+template<class T> void diff_append(Array<T>& x, const Array<T>& y, uint oldN) { NIY }
+}
+
 
 //===========================================================================
 //
@@ -160,8 +160,10 @@ static const int successor[16][4] = {
 
 #endif /* CONSTRUCT_TABLES */
 
-static REAL delta_values[TWICE_TWO_TO_DIM][DIM_PLUS_ONE];
-static REAL dot_products[DIM_PLUS_ONE][DIM_PLUS_ONE];
+/* working storage of one gjk_distance call: thread-local, so that
+   concurrent calls (e.g. parallel feature evaluation) don't share it */
+static __thread REAL delta_values[TWICE_TWO_TO_DIM][DIM_PLUS_ONE];
+static __thread REAL dot_products[DIM_PLUS_ONE][DIM_PLUS_ONE];
 
 #ifdef CONSTRUCT_TABLES
 static void initialise_simplex_distance( void);
@@ -523,7 +525,7 @@ int gjk_extract_point( struct simplex_point *simp,
   return 1;
 }
 
-static REAL delta[TWICE_TWO_TO_DIM];
+static __thread REAL delta[TWICE_TWO_TO_DIM];
 
 /* The simplex_distance routine requires the computation of a number of
    delta terms.  These are computed here.
@@ -0,0 +1,249 @@
+/*  ------------------------------------------------------------------
+    Copyright (c) 2011-2020 Marc Toussaint
+    email: toussaint@tu-berlin.de
+
+    This code is distributed under the MIT License.
+    Please see <root-path>/LICENSE for details.
+    --------------------------------------------------------------  */
+
+#include "aabbTree.h"
+
+namespace rai {
+
+static bool _overlap(const double* alo, const double* ahi, const double* blo, const double* bhi) {
+  return alo[0]<=bhi[0] && blo[0]<=ahi[0]
+         && alo[1]<=bhi[1] && blo[1]<=ahi[1]
+         && alo[2]<=bhi[2] && blo[2]<=ahi[2];
+}
+
+static bool _encloses(const AABBTree::Node& n, const double* lo, const double* hi) {
+  return n.lo[0]<=lo[0] && n.lo[1]<=lo[1] && n.lo[2]<=lo[2]
+         && hi[0]<=n.hi[0] && hi[1]<=n.hi[1] && hi[2]<=n.hi[2];
+}
+
+static double _surface(const double* lo, const double* hi) {
+  double dx=hi[0]-lo[0], dy=hi[1]-lo[1], dz=hi[2]-lo[2];
+  return 2.*(dx*dy + dy*dz + dz*dx);
+}
+
+static double _unionSurface(const AABBTree::Node& a, const AABBTree::Node& b) {
+  double lo[3], hi[3];
+  for(uint k=0; k<3; k++) { lo[k]=rai::MIN(a.lo[k], b.lo[k]);  hi[k]=rai::MAX(a.hi[k], b.hi[k]); }
+  return _surface(lo, hi);
+}
+
+//===========================================================================
+
+void AABBTree::clear() {
+  nodes.clear();
+  leaf.clear();
+  root=freeNode=-1;
+}
+
+void AABBTree::insert(uint id, const double* lo, const double* hi) {
+  CHECK(!contains(id), "id " <<id <<" is already in the tree");
+  if(id>=leaf.N) {
+    uint n=leaf.N;
+    leaf.resizeCopy(id+1);
+    for(uint k=n; k<leaf.N; k++) leaf.p[k]=-1;
+  }
+  int i=allocateNode();
+  Node& n=nodes(i);
+  for(uint k=0; k<3; k++) { n.lo[k]=lo[k]-margin;  n.hi[k]=hi[k]+margin; }
+  n.id=id;
+  leaf(id)=i;
+  insertLeaf(i);
+}
+
+void AABBTree::remove(uint id) {
+  CHECK(contains(id), "id " <<id <<" is not in the tree");
+  int i=leaf(id);
+  removeLeaf(i);
+  freeNodeAt(i);
+  leaf(id)=-1;
+}
+
+bool AABBTree::update(uint id, const double* lo, const double* hi) {
+  CHECK(contains(id), "id " <<id <<" is not in the tree");
+  int i=leaf(id);
+  if(_encloses(nodes(i), lo, hi)) return false;
+  removeLeaf(i);
+  Node& n=nodes(i);
+  for(uint k=0; k<3; k++) { n.lo[k]=lo[k]-margin;  n.hi[k]=hi[k]+margin; }
+  insertLeaf(i);
+  return true;
+}
+
+void AABBTree::getOverlappingPairs(uintA& pairs) const {
+  pairs.clear();
+  if(root>=0) selfPairs(pairs, root);
+  pairs.reshape(pairs.N/2, 2);
+}
+
+void AABBTree::query(uintA& ids, const double* lo, const double* hi) const {
+  ids.clear();
+  if(root<0) return;
+  intA stack = {root};
+  while(stack.N) {
+    const Node& n=nodes(stack.popLast());
+    if(!_overlap(n.lo, n.hi, lo, hi)) continue;
+    if(n.isLeaf()) ids.append(n.id);
+    else { stack.append(n.left);  stack.append(n.right); }
+  }
+}
+
+void AABBTree::checkConsistency() const {
+  uint leaves=0;
+  for(uint id=0; id<leaf.N; id++) if(leaf(id)>=0) {
+      leaves++;
+      CHECK(nodes(leaf(id)).isLeaf() && nodes(leaf(id)).id==id, "");
+    }
+  if(root<0) { CHECK(!leaves, ""); return; }
+  CHECK_EQ(nodes(root).parent, -1, "");
+  uint count=0;
+  intA stack = {root};
+  while(stack.N) {
+    int i=stack.popLast();
+    const Node& n=nodes(i);
+    if(n.isLeaf()) { count++;  CHECK_EQ(n.height, 0, "");  continue; }
+    const Node& l=nodes(n.left), &r=nodes(n.right);
+    CHECK(l.parent==i && r.parent==i, "broken parent link");
+    CHECK_EQ(n.height, 1+rai::MAX(l.height, r.height), "");
+    CHECK(_encloses(n, l.lo, l.hi) && _encloses(n, r.lo, r.hi), "box doesn't enclose its children");
+    stack.append(n.left);  stack.append(n.right);
+  }
+  CHECK_EQ(count, leaves, "");
+}
+
+//===========================================================================
+
+int AABBTree::allocateNode() {
+  if(freeNode<0) {
+    nodes.append(Node());
+    return nodes.N-1;
+  }
+  int i=freeNode;
+  freeNode=nodes(i).parent;
+  nodes(i) = Node();
+  return i;
+}
+
+void AABBTree::freeNodeAt(int i) {
+  nodes(i).parent=freeNode;
+  nodes(i).height=-1;
+  freeNode=i;
+}
+
+void AABBTree::fit(int i) {
+  Node& n=nodes(i);
+  const Node& l=nodes(n.left), &r=nodes(n.right);
+  for(uint k=0; k<3; k++) { n.lo[k]=rai::MIN(l.lo[k], r.lo[k]);  n.hi[k]=rai::MAX(l.hi[k], r.hi[k]); }
+  n.height = 1+rai::MAX(l.height, r.height);
+}
+
+void AABBTree::insertLeaf(int i) {
+  if(root<0) { root=i;  nodes(i).parent=-1;  return; }
+
+  //-- descend to the sibling that increases the total surface least
+  int s=root;
+  for(;;) {
+    const Node& S=nodes(s), &L=nodes(i);
+    if(S.isLeaf()) break;
+    double combined=_unionSurface(S, L);
+    double cost=2.*combined;                          //pair L with S itself
+    double inherit=2.*(combined-_surface(S.lo, S.hi)); //growth of S (and all ancestors) when descending
+    double costChild[2];
+    int child[2] = {S.left, S.right};
+    for(uint c=0; c<2; c++) {
+      const Node& C=nodes(child[c]);
+      costChild[c] = _unionSurface(C, L) + inherit;
+      if(!C.isLeaf()) costChild[c] -= _surface(C.lo, C.hi);
+    }
+    if(cost<costChild[0] && cost<costChild[1]) break;
+    s = costChild[0]<costChild[1] ? child[0] : child[1];
+  }
+
+  //-- new parent of s and i
+  int oldParent=nodes(s).parent;
+  int p=allocateNode();
+  nodes(p).parent=oldParent;
+  nodes(p).left=s;  nodes(p).right=i;
+  nodes(s).parent=p;  nodes(i).parent=p;
+  fit(p);
+  if(oldParent<0) root=p;
+  else if(nodes(oldParent).left==s) nodes(oldParent).left=p;
+  else nodes(oldParent).right=p;
+
+  //-- refit and rebalance upward
+  for(int j=nodes(p).parent; j>=0; j=nodes(j).parent) {
+    j=balance(j);
+    fit(j);
+  }
+}
+
+void AABBTree::removeLeaf(int i) {
+  if(i==root) { root=-1;  return; }
+  int p=nodes(i).parent, g=nodes(p).parent;
+  int s = nodes(p).left==i ? nodes(p).right : nodes(p).left;
+  nodes(s).parent=g;
+  if(g<0) root=s;
+  else if(nodes(g).left==p) nodes(g).left=s;
+  else nodes(g).right=s;
+  freeNodeAt(p);
+  for(int j=g; j>=0; j=nodes(j).parent) {
+    j=balance(j);
+    fit(j);
+  }
+}
+
+//rotates the higher child up if the subtree at a is unbalanced; returns the new subtree root
+int AABBTree::balance(int a) {
+  Node& A=nodes(a);
+  if(A.isLeaf() || A.height<2) return a;
+  int b=A.left, c=A.right;
+  int bal = nodes(c).height - nodes(b).height;
+  if(bal>-2 && bal<2) return a;
+
+  //u is the child to rotate up, its children x,y; the higher one stays with u, the other goes to a
+  int u = bal>1 ? c : b;
+  Node& U=nodes(u);
+  int x=U.left, y=U.right;
+  U.left=a;
+  U.parent=A.parent;
+  A.parent=u;
+  if(U.parent<0) root=u;
+  else if(nodes(U.parent).left==a) nodes(U.parent).left=u;
+  else nodes(U.parent).right=u;
+  if(nodes(x).height>nodes(y).height) std::swap(x, y); //y is the higher
+  U.right=y;
+  if(bal>1) A.right=x; else A.left=x;
+  nodes(x).parent=a;
+  fit(a);
+  fit(u);
+  return u;
+}
+
+void AABBTree::selfPairs(uintA& pairs, int i) const {
+  const Node& n=nodes(i);
+  if(n.isLeaf()) return;
+  selfPairs(pairs, n.left);
+  selfPairs(pairs, n.right);
+  crossPairs(pairs, n.left, n.right);
+}
+
+void AABBTree::crossPairs(uintA& pairs, int a, int b) const {
+  const Node& A=nodes(a), &B=nodes(b);
+  if(!_overlap(A.lo, A.hi, B.lo, B.hi)) return;
+  if(A.isLeaf() && B.isLeaf()) {
+    pairs.append(std::min(A.id, B.id));
+    pairs.append(std::max(A.id, B.id));
+  } else if(B.isLeaf() || (!A.isLeaf() && A.height>=B.height)) {
+    crossPairs(pairs, A.left, b);
+    crossPairs(pairs, A.right, b);
+  } else {
+    crossPairs(pairs, a, B.left);
+    crossPairs(pairs, a, B.right);
+  }
+}
+
+}
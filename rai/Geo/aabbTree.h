@@ -0,0 +1,60 @@
+/*  ------------------------------------------------------------------
+    Copyright (c) 2011-2020 Marc Toussaint
+    email: toussaint@tu-berlin.de
+
+    This code is distributed under the MIT License.
+    Please see <root-path>/LICENSE for details.
+    --------------------------------------------------------------  */
+
+#pragma once
+
+#include "../Core/array.h"
+
+namespace rai {
+
+//===========================================================================
+
+/// dynamic AABB tree: a balanced bounding volume hierarchy over axis-aligned boxes keyed by (small integer) ids,
+/// updated incrementally. Leaves store 'fat' boxes (inflated by margin), so that small motions leave the tree unchanged.
+struct AABBTree {
+  struct Node {
+    double lo[3], hi[3];
+    int parent=-1;          ///< (for free nodes: the next free node)
+    int left=-1, right=-1;  ///< children (-1 for leaves)
+    int height=0;           ///< 0 for leaves (-1 for free nodes)
+    uint id=0;              ///< for leaves: the id of the box
+    bool isLeaf() const { return left==-1; }
+  };
+
+  Array<Node> nodes;
+  int root=-1;
+  int freeNode=-1;  ///< head of the list of free nodes
+  intA leaf;        ///< for each id, its leaf node (-1 if not contained)
+  double margin;    ///< inflation of the leaf boxes
+
+  AABBTree(double margin=.05) : margin(margin) { nodes.memMove=true; }
+
+  void clear();
+  bool contains(uint id) const { return id<leaf.N && leaf.p[id]>=0; }
+  void insert(uint id, const double* lo, const double* hi);
+  void remove(uint id);
+  bool update(uint id, const double* lo, const double* hi); ///< returns true if the box left its fat box and was reinserted
+
+  void getOverlappingPairs(uintA& pairs) const; ///< all pairs of ids (as rows, smaller id first) whose fat boxes overlap
+  void query(uintA& ids, const double* lo, const double* hi) const; ///< all ids whose fat boxes overlap [lo,hi]
+
+  uint height() const { return root<0 ? 0 : nodes(root).height; }
+  void checkConsistency() const;
+
+ private:
+  int allocateNode();
+  void freeNodeAt(int i);
+  void insertLeaf(int i);
+  void removeLeaf(int i);
+  int balance(int i);
+  void fit(int i);
+  void selfPairs(uintA& pairs, int i) const;
+  void crossPairs(uintA& pairs, int a, int b) const;
+};
+
+}
@@ -1,4 +1,7 @@
 #include "analyticShapes.h"
+#include "mesh.h"
+
+#include <queue>
 
 DistanceFunction_Sphere::DistanceFunction_Sphere(const rai::Transformation& _pose, double _r):pose(_pose), r(_r) {
   ScalarFunction::operator=([this](arr& g, arr& H, const arr& x)->double{ return f(g, H, x); });
@@ -248,3 +251,173 @@ ScalarFunction DistanceFunction_SSBox = [](arr& g, arr& H, const arr& x) -> doub
   return d;
 };
 
+
+//===========================================================================
+
+//closest point c on triangle abc to p (Ericson, Real-Time Collision Detection, 5.1.5)
+static void closestPointOnTriangle(double* c, const double* p, const double* a, const double* b, const double* cc) {
+  double ab[3], ac[3], ap[3];
+  for(uint k=0; k<3; k++) { ab[k]=b[k]-a[k];  ac[k]=cc[k]-a[k];  ap[k]=p[k]-a[k]; }
+  auto dot = [](const double* x, const double* y) { return x[0]*y[0]+x[1]*y[1]+x[2]*y[2]; };
+  auto set = [c](const double* x, double s, const double* y, double t, const double* z) { for(uint k=0; k<3; k++) c[k]=x[k]+s*y[k]+t*z[k]; };
+  double d1=dot(ab, ap), d2=dot(ac, ap);
+  if(d1<=0. && d2<=0.) { set(a, 0., ab, 0., ac);  return; }
+  double bp[3];
+  for(uint k=0; k<3; k++) bp[k]=p[k]-b[k];
+  double d3=dot(ab, bp), d4=dot(ac, bp);
+  if(d3>=0. && d4<=d3) { set(b, 0., ab, 0., ac);  return; }
+  double vc=d1*d4-d3*d2;
+  if(vc<=0. && d1>=0. && d3<=0.) { set(a, d1/(d1-d3), ab, 0., ac);  return; }
+  double cp[3];
+  for(uint k=0; k<3; k++) cp[k]=p[k]-cc[k];
+  double d5=dot(ab, cp), d6=dot(ac, cp);
+  if(d6>=0. && d5<=d6) { set(cc, 0., ab, 0., ac);  return; }
+  double vb=d5*d2-d1*d6;
+  if(vb<=0. && d2>=0. && d6<=0.) { set(a, 0., ab, d2/(d2-d6), ac);  return; }
+  double va=d3*d6-d5*d4;
+  if(va<=0. && (d4-d3)>=0. && (d5-d6)>=0.) {
+    double w=(d4-d3)/((d4-d3)+(d5-d6));
+    for(uint k=0; k<3; k++) c[k]=b[k]+w*(cc[k]-b[k]);
+    return;
+  }
+  double denom=1./(va+vb+vc);
+  set(a, vb*denom, ab, vc*denom, ac);
+}
+
+void DistanceFunction_Grid::resize(const double* _lo, const double* _hi) {
+  CHECK_GE(band, 2.*res, "the band needs to be at least two cells wide to separate inside from outside");
+  uint n[3];
+  for(uint k=0; k<3; k++) {
+    lo[k] = _lo[k]-band;
+    n[k] = 2+uint(ceil((_hi[k]-_lo[k]+2.*band)/res));
+  }
+  values.resize(n[0], n[1], n[2]);
+}
+
+DistanceFunction_Grid::DistanceFunction_Grid(const rai::Mesh& mesh, double _res, double _band) : res(_res), band(_band) {
+  CHECK(mesh.V.N && mesh.T.N, "need a triangle mesh");
+  arr bounds = mesh.getBox();
+  resize(bounds.p, bounds.p+3);
+  uint n0=values.d0, n1=values.d1, n2=values.d2;
+
+  //-- unsigned distance within the band: each triangle visits the grid points near it
+  arr dist(values.N), cosine(values.N);
+  intA sign(values.N);
+  dist = band;
+  cosine = 0.;
+  sign = 0;
+  double p[3], c[3], nrm[3];
+  for(uint t=0; t<mesh.T.d0; t++) {
+    const double* a=&mesh.V(mesh.T(t, 0), 0), *b=&mesh.V(mesh.T(t, 1), 0), *cc=&mesh.V(mesh.T(t, 2), 0);
+    nrm[0]=(b[1]-a[1])*(cc[2]-a[2])-(b[2]-a[2])*(cc[1]-a[1]);
+    nrm[1]=(b[2]-a[2])*(cc[0]-a[0])-(b[0]-a[0])*(cc[2]-a[2]);
+    nrm[2]=(b[0]-a[0])*(cc[1]-a[1])-(b[1]-a[1])*(cc[0]-a[0]);
+    double l=sqrt(nrm[0]*nrm[0]+nrm[1]*nrm[1]+nrm[2]*nrm[2]);
+    if(l<1e-20) continue; //degenerate triangle
+    for(uint k=0; k<3; k++) nrm[k]/=l;
+    int from[3], to[3];
+    uint n[3]= {n0, n1, n2};
+    for(uint k=0; k<3; k++) {
+      double tlo=rai::MIN(a[k], rai::MIN(b[k], cc[k]))-band, thi=rai::MAX(a[k], rai::MAX(b[k], cc[k]))+band;
+      from[k]=std::max(0, int(ceil((tlo-lo[k])/res)));
+      to[k]=std::min(int(n[k])-1, int(floor((thi-lo[k])/res)));
+    }
+    for(int i=from[0]; i<=to[0]; i++) for(int j=from[1]; j<=to[1]; j++) for(int k=from[2]; k<=to[2]; k++) {
+          uint idx=(i*n1+j)*n2+k;
+          p[0]=lo[0]+i*res;  p[1]=lo[1]+j*res;  p[2]=lo[2]+k*res;
+          closestPointOnTriangle(c, p, a, b, cc);
+          double d[3]= {p[0]-c[0], p[1]-c[1], p[2]-c[2]};
+          double len=sqrt(d[0]*d[0]+d[1]*d[1]+d[2]*d[2]);
+          if(len>band) continue;
+          double cs = d[0]*nrm[0]+d[1]*nrm[1]+d[2]*nrm[2];
+          if(len>1e-12) cs/=len; else cs=1.;
+          //at edges and vertices several triangles are equally close: the one facing p most decides the sign
+          if(len<dist.p[idx]-1e-12 || (len<dist.p[idx]+1e-12 && fabs(cs)>cosine.p[idx])) {
+            dist.p[idx]=len;
+            cosine.p[idx]=fabs(cs);
+            sign.p[idx]= cs<0. ? -1 : 1;
+          }
+        }
+  }
+
+  //-- points beyond the band inherit the sign of their region (flood fill from the band)
+  std::queue<uint> Q;
+  for(uint idx=0; idx<sign.N; idx++) if(sign.p[idx]) Q.push(idx);
+  while(!Q.empty()) {
+    uint idx=Q.front();  Q.pop();
+    uint i=idx/(n1*n2), j=(idx/n2)%n1, k=idx%n2;
+    uint nb[6];
+    uint m=0;
+    if(i>0) nb[m++]=idx-n1*n2;
+    if(i+1<n0) nb[m++]=idx+n1*n2;
+    if(j>0) nb[m++]=idx-n2;
+    if(j+1<n1) nb[m++]=idx+n2;
+    if(k>0) nb[m++]=idx-1;
+    if(k+1<n2) nb[m++]=idx+1;
+    for(uint l=0; l<m; l++) if(!sign.p[nb[l]]) { sign.p[nb[l]]=sign.p[idx];  Q.push(nb[l]); }
+  }
+
+  for(uint idx=0; idx<values.N; idx++) values.p[idx] = (sign.p[idx]<0 ? -1. : 1.)*dist.p[idx];
+
+  ScalarFunction::operator=([this](arr& g, arr& H, const arr& x)->double{ return f(g, H, x); });
+}
+
+DistanceFunction_Grid::DistanceFunction_Grid(ScalarFunction& f, const arr& _lo, const arr& _hi, double _res, double _band) : res(_res), band(_band) {
+  CHECK(_lo.N==3 && _hi.N==3, "");
+  resize(_lo.p, _hi.p);
+  arr x(3);
+  double* v=values.p;
+  for(uint i=0; i<values.d0; i++) for(uint j=0; j<values.d1; j++) for(uint k=0; k<values.d2; k++) {
+        x = {lo[0]+i*res, lo[1]+j*res, lo[2]+k*res};
+        double d = f(NoArr, NoArr, x);
+        *(v++) = clip(d, -band, band);
+      }
+
+  ScalarFunction::operator=([this](arr& g, arr& H, const arr& x)->double{ return DistanceFunction_Grid::f(g, H, x); });
+}
+
+double DistanceFunction_Grid::lookup(double* g, const double* x) const {
+  uint n[3]= {values.d0, values.d1, values.d2};
+  int i[3];
+  double t[3], out[3], outside=0.;
+  for(uint k=0; k<3; k++) {
+    double u=(x[k]-lo[k])/res, uc=u;
+    if(uc<0.) uc=0.;
+    if(uc>n[k]-1) uc=n[k]-1;
+    out[k]=(u-uc)*res;
+    outside += out[k]*out[k];
+    i[k]=int(uc);
+    if(i[k]>int(n[k])-2) i[k]=n[k]-2;
+    t[k]=uc-i[k];
+  }
+
+  //-- trilinear interpolation (v_ijk are the corners of the cell)
+  uint s0=n[1]*n[2], s1=n[2];
+  const double* v=values.p + i[0]*s0 + i[1]*s1 + i[2];
+  double dz00=v[1]-v[0], dz01=v[s1+1]-v[s1], dz10=v[s0+1]-v[s0], dz11=v[s0+s1+1]-v[s0+s1];
+  double c00=v[0]+t[2]*dz00, c01=v[s1]+t[2]*dz01, c10=v[s0]+t[2]*dz10, c11=v[s0+s1]+t[2]*dz11;
+  double c0=c00+t[1]*(c01-c00), c1=c10+t[1]*(c11-c10);
+  double d=c0+t[0]*(c1-c0);
+
+  if(outside>0.) { //beyond the grid: add the distance to the grid box
+    outside=sqrt(outside);
+    if(g) for(uint k=0; k<3; k++) g[k]=out[k]/outside;
+    return d+outside;
+  }
+  if(g) {
+    g[0]=(c1-c0)/res;
+    g[1]=((1.-t[0])*(c01-c00) + t[0]*(c11-c10))/res;
+    g[2]=((1.-t[0])*((1.-t[1])*dz00 + t[1]*dz01) + t[0]*((1.-t[1])*dz10 + t[1]*dz11))/res;
+  }
+  return d;
+}
+
+double DistanceFunction_Grid::f(arr& g, arr& H, const arr& x) {
+  CHECK_EQ(x.N, 3, "");
+  rai::Vector y = pose / rai::Vector(x);
+  double gy[3];
+  double d = lookup(!!g?gy:0, &y.x);
+  if(!!g) { rai::Vector gw = pose.rot * rai::Vector(gy[0], gy[1], gy[2]);  g = {gw.x, gw.y, gw.z}; }
+  if(!!H) H.resize(3, 3).setZero();
+  return d;
+}
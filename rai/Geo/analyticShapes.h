@@ -40,3 +40,27 @@ struct DistanceFunction_Capsule : ScalarFunction {
 };
 
 extern ScalarFunction DistanceFunction_SSBox;
+
+//===========================================================================
+
+namespace rai { struct Mesh; }
+
+/// signed distance sampled on a regular grid (in the coordinates of 'pose'), looked up by trilinear interpolation.
+/// Only a narrow band around the surface is exact: values are clamped to [-band, band] (beyond the grid, the distance
+/// to the grid box is added); within the band, interpolation errs by up to about .4*res close to edges and the medial axis.
+/// Precomputation is meant for static geometry, queried many times
+struct DistanceFunction_Grid : ScalarFunction {
+  rai::Transformation pose=0;
+  double lo[3];      ///< grid origin
+  double res, band;  ///< grid spacing, band width
+  arr values;        ///< d0 x d1 x d2 grid values
+
+  DistanceFunction_Grid(const rai::Mesh& mesh, double _res=.02, double _band=.1); ///< exact distance to the triangles, signed by the (outward) triangle normals
+  DistanceFunction_Grid(ScalarFunction& f, const arr& _lo, const arr& _hi, double _res=.02, double _band=.1); ///< samples an analytic distance function
+
+  double lookup(double* g, const double* x) const; ///< distance and gradient (g may be null) at x, both in grid coordinates; allocation free
+  double f(arr& g, arr& H, const arr& x);
+
+ private:
+  void resize(const double* _lo, const double* _hi);
+};
@@ -948,6 +948,11 @@ void Quaternion::applyOnPointArray(arr& pts) {
 /// this is a 3-by-4 matrix $J$, giving the angular velocity vector $w = J \dot q$  induced by a $\dot q$
 arr Quaternion::getJacobian() const {
   arr J(3, 4);
+  getJacobian(J.p);
+  return J;
+}
+
+double* Quaternion::getJacobian(double* J) const {
   rai::Quaternion e;
   for(uint i=0; i<4; i++) {
     if(i==0) e.set(1., 0., 0., 0.);
@@ -955,9 +960,9 @@ arr Quaternion::getJacobian() const {
     if(i==2) e.set(0., 0., 1., 0.);
     if(i==3) e.set(0., 0., 0., 1.); //TODO: the following could be simplified/compressed/made more efficient
     e = e / *this;
-    J(0, i) = -2.*e.x;
-    J(1, i) = -2.*e.y;
-    J(2, i) = -2.*e.z;
+    J[i] = -2.*e.x;
+    J[4+i] = -2.*e.y;
+    J[8+i] = -2.*e.z;
   }
   return J;
 }
@@ -1144,7 +1149,10 @@ double quat_scalarProduct(const Quaternion& a, const Quaternion& b) {
   return a.w*b.w+a.x*b.x+a.y*b.y+a.z*b.z;
 }
 
-void quat_concat(arr& y, arr& Ja, arr& Jb, const arr& A, const arr& B) {
+void quat_concat(arr& y, arr& _Ja, arr& _Jb, const arr& A, const arr& B) {
+  arr Ja_, Jb_; //the Jacobians are also needed to propagate those of A and B (autodiff)
+  arr& Ja = (!_Ja && A.jac) ? Ja_ : _Ja;
+  arr& Jb = (!_Jb && B.jac) ? Jb_ : _Jb;
   rai::Quaternion a(A);
   rai::Quaternion b(B);
   a.isZero=b.isZero=false;
@@ -1169,10 +1177,15 @@ void quat_concat(arr& y, arr& Ja, arr& Jb, const arr& A, const arr& B) {
     Jb(2, 1) = a.z; Jb(2, 2) = a.w; Jb(2, 3) =-a.x;
     Jb(3, 1) =-a.y; Jb(3, 2) = a.x; Jb(3, 3) = a.w;
   }
+  diff_chain(y, Ja, A);
+  diff_chain(y, Jb, B);
 }
 
-void quat_normalize(arr& y, arr& J, const arr& a) {
-  y = a;
+void quat_normalize(arr& y, arr& _J, const arr& a) {
+  arr J_;
+  arr& J = (!_J && a.jac) ? J_ : _J;
+  arr a0;
+  y = diff_value(a0, a);
   double l2 = sumOfSqr(y);
   double l = sqrt(l2);
   y /= l;
@@ -1181,11 +1194,15 @@ void quat_normalize(arr& y, arr& J, const arr& a) {
     J -= y^y;
     J /= l;
   }
+  diff_chain(y, J, a);
 }
 
-void quat_getVec(arr& y, arr& J, const arr& A) {
+void quat_getVec(arr& y, arr& _J, const arr& A) {
+  arr J_;
+  arr& J = (!_J && A.jac) ? J_ : _J;
   rai::Quaternion a(A);
   y.resize(3);
+  y.jac.reset();
   double phi, sinphi, s;
   double dphi, dsinphi, ds=0.;
   if(a.w>=1. || a.w<=-1. || (a.x==0. && a.y==0. && a.z==0.)) {
@@ -1194,6 +1211,7 @@ void quat_getVec(arr& y, arr& J, const arr& A) {
       J.resize(3, 4).setZero();
       J(0, 1) = J(1, 2) = J(2, 3) = 2.;
     }
+    diff_chain(y, J, A);
     return;
   }
 
@@ -1227,9 +1245,12 @@ void quat_getVec(arr& y, arr& J, const arr& A) {
     J(1, 0) = a.y*ds;
     J(2, 0) = a.z*ds;
   }
+  diff_chain(y, J, A);
 }
 
-void quat_diffVector(arr& y, arr& Ja, arr& Jb, const arr& a, const arr& b) {
+void quat_diffVector(arr& y, arr& Ja, arr& Jb, const arr& _a, const arr& _b) {
+  arr a0, b0;
+  const arr& a = diff_value(a0, _a), &b = diff_value(b0, _b);
   arr ab, Jca, Jcb;
   arr binv = b;
   binv(0) *= -1.;
@@ -1238,8 +1259,11 @@ void quat_diffVector(arr& y, arr& Ja, arr& Jb, const arr& a, const arr& b) {
 
   arr Jvec;
   quat_getVec(y, Jvec, ab);
-  Ja = Jvec * Jca;
-  Jb = Jvec * Jcb;
+  arr JA = Jvec * Jca, JB = Jvec * Jcb;
+  diff_chain(y, JA, _a);
+  diff_chain(y, JB, _b);
+  if(!!Ja) Ja = JA;
+  if(!!Jb) Jb = JB;
 }
 
 //==============================================================================
@@ -158,6 +158,7 @@ struct Quaternion {
   void applyOnPointArray(arr& pts);
 
   arr getJacobian() const;
+  double* getJacobian(double* J) const; //3x4, row-major
   arr getMatrixJacobian() const;
 
   arr getQuaternionMultiplicationMatrix() const; //turns a RHS(!) quat multiplication into a LHS(!) matrix multiplication
@@ -317,7 +318,7 @@ void mult(Vector& a, const Quaternion& b, const Vector& c, bool add); //a += b*c
 double sqrDistance(const rai::Vector& a, const rai::Vector& b);
 // quaternion methods
 double quat_scalarProduct(const rai::Quaternion& a, const rai::Quaternion& b);
-// differentiable operations:
+// differentiable operations (these also propagate the autodiff Jacobians x.jac of their arguments):
 void quat_concat(arr& y, arr& Ja, arr& Jb, const arr& A, const arr& B);
 void quat_normalize(arr& y, arr& J, const arr& a);
 void quat_getVec(arr& y, arr& J, const arr& A);
@@ -13,6 +13,7 @@
 #include "../Optim/newton.h"
 
 #include <limits>
+#include <atomic>
 
 #ifdef RAI_PLY
 #  include "ply/ply.h"
@@ -41,13 +42,23 @@ template<> const char* rai::Enum<rai::ShapeType>::names []= {
 rai::Mesh::Mesh()
   : glX(0)
     /*parsing_pos_start(0),
-    parsing_pos_end(std::numeric_limits<long>::max())*/{}
+    parsing_pos_end(std::numeric_limits<long>::max())*/{
+  touchV();
+}
+
+void rai::Mesh::touchV() {
+  static std::atomic<uint> lastRevision(0);
+  revision = ++lastRevision;
+  lod.reset();  lodMargin=0.;
+}
 
 void rai::Mesh::clear() {
+  touchV();
   V.clear(); Vn.clear();
   if(C.nd==2) C.clear();
   T.clear(); Tn.clear();
-  graph.clear();
+  graph.clear(); graphRings.clear();
+  isConvex=false;
 }
 
 void rai::Mesh::setBox() {
@@ -75,7 +86,6 @@ void rai::Mesh::setBox() {
   V.reshape(8, 3);
   T.reshape(12, 3);
   Vn.clear(); Tn.clear();
-  graph.clear();
   //cout <<V <<endl;  for(uint i=0;i<4;i++) cout <<length(V[i]) <<endl;
 }
 
@@ -270,6 +280,7 @@ rai::Mesh& rai::Mesh::setRandom(uint vertices) {
 }
 
 void rai::Mesh::subDivide() {
+  touchV();
   uint v=V.d0, t=T.d0;
   V.resizeCopy(v+3*t, 3);
   uintA newT(4*t, 3);
@@ -290,6 +301,7 @@ void rai::Mesh::subDivide() {
 }
 
 void rai::Mesh::subDivide(uint i) {
+  touchV();
   uint v=V.d0, t=T.d0;
   V.resizeCopy(v+3, 3);
   T.resizeCopy(t+3, 3);
@@ -304,14 +316,16 @@ void rai::Mesh::subDivide(uint i) {
   T(t, 0)=v+2; T(t, 1)=v+1; T(t, 2)=c;   t++;
 }
 
-void rai::Mesh::scale(double f) {  V *= f; }
+void rai::Mesh::scale(double f) {  touchV();  V *= f; }
 
 void rai::Mesh::scale(double sx, double sy, double sz) {
+  touchV();
   uint i;
   for(i=0; i<V.d0; i++) {  V(i, 0)*=sx;  V(i, 1)*=sy;  V(i, 2)*=sz;  }
 }
 
 void rai::Mesh::translate(double dx, double dy, double dz) {
+  touchV();
   uint i;
   for(i=0; i<V.d0; i++) {  V(i, 0)+=dx;  V(i, 1)+=dy;  V(i, 2)+=dz;  }
 }
@@ -322,16 +336,19 @@ void rai::Mesh::translate(const arr& d) {
 }
 
 void rai::Mesh::transform(const rai::Transformation& t) {
+  touchV();
   t.applyOnPointArray(V);
 }
 
 rai::Vector rai::Mesh::center() {
+  touchV();
   arr Vmean = mean(V);
   for(uint i=0; i<V.d0; i++) V[i]() -= Vmean;
   return Vector(Vmean);
 }
 
 void rai::Mesh::box() {
+  touchV();
   double x, X, y, Y, z, Z, m;
   x=X=V(0, 0);
   y=Y=V(0, 1);
@@ -352,6 +369,7 @@ void rai::Mesh::box() {
 }
 
 void rai::Mesh::addMesh(const Mesh& mesh2, const rai::Transformation& X) {
+  touchV();
   uint n=V.d0, tn=tex.d0, t=T.d0, tt=Tt.d0;
   V.append(mesh2.V);
   if(V.N==C.N && mesh2.V.N==mesh2.C.N) C.append(mesh2.C); else C.clear();
@@ -374,6 +392,7 @@ void rai::Mesh::addMesh(const Mesh& mesh2, const rai::Transformation& X) {
 }
 
 void rai::Mesh::makeConvexHull() {
+  touchV();
   if(V.d0<=1) return;
 #if 1
   V = getHull(V, T);
@@ -405,6 +424,8 @@ void rai::Mesh::makeConvexHull() {
   }
 
 #endif
+  isConvex=true;
+  buildGraph(); //eagerly, so that support() on a shared hull never writes the graph
 }
 
 void rai::Mesh::makeTriangleFan() {
@@ -425,6 +446,7 @@ void rai::Mesh::makeLineStrip() {
 }
 
 void rai::Mesh::setSSCvx(const arr& core, double r, uint fineness) {
+  touchV();
   if(r>0.) {
     Mesh ball;
     ball.setSphere(fineness);
@@ -616,6 +638,7 @@ void permuteVertices(rai::Mesh& m, uintA& p) {
 /** @brief delete all void triangles (with vertex indices (0, 0, 0)) and void
   vertices (not used for triangles or strips) */
 void rai::Mesh::deleteUnusedVertices() {
+  touchV();
   if(!V.N) return;
   uintA p;
   uintA u;
@@ -647,6 +670,7 @@ bool COMP(uint i, uint j) {
 /** @brief delete all void triangles (with vertex indices (0, 0, 0)) and void
   vertices (not used for triangles or strips) */
 void rai::Mesh::fuseNearVertices(double tol) {
+  touchV();
   if(!V.N) return;
   uintA p;
   uint i, j;
@@ -727,6 +751,7 @@ void rai::Mesh::flipFaces() {
 
 /// check whether this is really a closed mesh, and flip inconsistent faces
 void rai::Mesh::clean() {
+  touchV();
   uint i, j, idist=0;
   Vector a, b, c, m;
   double mdist=0.;
@@ -934,6 +959,7 @@ void getTriNeighborsList(const rai::Mesh& m, uintA& Tt, intA& TT) {
 }
 
 void rai::Mesh::skin(uint start) {
+  touchV();
   intA TT;
   uintA Tt;
   getTriNeighborsList(*this, Tt, TT);
@@ -1093,7 +1119,7 @@ void rai::Mesh::read(std::istream& is, const char* fileExtension, const char* fi
   else if(!strcmp(fileExtension, "ply")) { readPLY(filename); }
   else if(!strcmp(fileExtension, "tri")) { readTriFile(is); }
   //  else if(!strcmp(fileExtension, "stl") || !strcmp(fileExtension, "STL")) { readStlFile(is); }
-  else if(!strcmp(fileExtension, "dae")) { *this = AssimpLoader(filename, true).getSingleMesh(); }
+  else if(!strcmp(fileExtension, "dae")) { *this = AssimpLoader(filename, true).getSingleMesh();  touchV(); }
   else {
     *this = AssimpLoader(filename, false).getSingleMesh();
   }
@@ -1112,6 +1138,7 @@ void rai::Mesh::writeTriFile(const char* filename) {
 }
 
 void rai::Mesh::readTriFile(std::istream& is) {
+  touchV();
   uint i, nV, nT;
   is >>PARSE("TRI") >>nV >>nT;
   V.resize(nV, 3);
@@ -1130,6 +1157,7 @@ void rai::Mesh::writeOffFile(const char* filename) {
 }
 
 void rai::Mesh::readOffFile(std::istream& is) {
+  touchV();
   uint i, k, nVertices, nFaces, nEdges, alpha;
   bool color;
   rai::String tag;
@@ -1154,6 +1182,7 @@ void rai::Mesh::readOffFile(std::istream& is) {
 }
 
 void rai::Mesh::readPlyFile(std::istream& is) {
+  touchV();
   uint i, k, nVertices, nFaces;
   rai::String str;
   is >>PARSE("ply") >>PARSE("format") >>str;
@@ -1247,6 +1276,7 @@ bool ply_check_property(PlyElement* elem, const char* prop_name) {
 }
 
 void rai::Mesh::readPLY(const char* fn) {
+  touchV();
   struct PlyFace {    unsigned char nverts;  int* verts; };
   struct Vertex {    double x,  y,  z ;  byte r, g, b; };
   uint _nverts=0, _ntrigs=0;
@@ -1352,6 +1382,7 @@ void rai::Mesh::writeArr(std::ostream& os) {
 }
 
 void rai::Mesh::readArr(std::istream& is) {
+  touchV();
   V.readTagged(is, "V");
   T.readTagged(is, "T");
   C.readTagged(is, "C");
@@ -1784,6 +1815,7 @@ void rai::Mesh::setImplicitSurface(ScalarFunction f, double lo, double hi, uint
 }
 
 void rai::Mesh::setImplicitSurface(ScalarFunction f, double xLo, double xHi, double yLo, double yHi, double zLo, double zHi, uint res) {
+  touchV();
   MarchingCubes mc(res, res, res);
   mc.init_all() ;
 
@@ -1821,6 +1853,7 @@ void rai::Mesh::setImplicitSurface(ScalarFunction f, double xLo, double xHi, dou
 }
 
 void rai::Mesh::setImplicitSurface(const arr& gridValues, const arr& lo, const arr& hi){
+  touchV();
   CHECK_EQ(gridValues.nd, 3, "");
 
   MarchingCubes mc(gridValues.d0, gridValues.d1, gridValues.d2);
@@ -1882,6 +1915,7 @@ void rai::Mesh::setImplicitSurfaceBySphereProjection(ScalarFunction f, double ra
 }
 
 void rai::Mesh::buildGraph() {
+  graph.clear();
   graph.resize(V.d0);
   for(uint i=0; i<T.d0; i++) {
     graph(T(i, 0)).setAppend(T(i, 1));
@@ -1891,58 +1925,62 @@ void rai::Mesh::buildGraph() {
     graph(T(i, 2)).setAppend(T(i, 0));
     graph(T(i, 2)).setAppend(T(i, 1));
   }
+
+  uint n=V.d0;
+  for(uint i=0; i<V.d0; i++) n += graph(i).N+1;
+  graphRings.resize(n);
+  n=V.d0;
+  for(uint i=0; i<V.d0; i++) {
+    graphRings(i) = n;
+    for(uint j:graph(i)) graphRings(n++) = j;
+    graphRings(n++) = -1;
+  }
 }
 
 inline double __scalarProduct(const double* p1, const double* p2) {
   return p1[0]*p2[0]+p1[1]*p2[1]+p1[2]*p2[2];
 }
 
-uint rai::Mesh::support(const double* dir) {
-#if 1
+//below this many vertices, a plain scan is cheaper than walking the graph
+static const uint Mesh_supportBruteForceMax = 32;
 
-  arr _dir(dir, 3, true);
-  arr q = V*_dir;
-  return argmax(q);
-
-#elif 0
-
-  double s = __scalarProduct(dir, V.p);
-  double ms=s;
-  uint mi=0;
-  for(uint i=0; i<V.d0; i++) {
-    s = __scalarProduct(dir, V.p+3*i);
-    if(s>ms) { ms = s;  mi = i; }
-  }
-  _support_vertex = mi;
-  return _support_vertex;
-
-#else
-  if(!graph.N) buildGraph();
-
-  uint mi = _support_vertex;
-  double s = __scalarProduct(dir, V.p+3*mi);
-  double ms=s;
-  for(;;) {
-    //comput scalar product for all neighbors
-    uintA& neigh=graph.p[mi];
-
-    bool stop=true;
-    for(uint i:neigh) {
-      s = __scalarProduct(dir, V.p+3*i);
-      if(s>ms) {
-        mi = i;
-        ms = s;
-        stop = false;
-        break;
-      }
+uint rai::Mesh::support(const double* dir) {
+  return support(dir, _support_vertex);
+}
+
+uint rai::Mesh::support(const double* dir, uint& seed) const {
+  const double* v=V.p;
+  uint n=V.d0;
+  CHECK(n, "support of empty mesh");
+
+  if(!isConvex || n<=Mesh_supportBruteForceMax || graph.N!=n) {
+    //scan -- two vertices per step, no temporaries
+    double ms=__scalarProduct(dir, v);
+    uint mi=0, i=1;
+    for(; i+1<n; i+=2) {
+      double s0=__scalarProduct(dir, v+3*i);
+      double s1=__scalarProduct(dir, v+3*i+3);
+      if(s0>ms) { ms=s0; mi=i; }
+      if(s1>ms) { ms=s1; mi=i+1; }
     }
-    if(stop) {
-      _support_vertex = mi;
-      return _support_vertex;
+    if(i<n) { double s=__scalarProduct(dir, v+3*i); if(s>ms) { ms=s; mi=i; } }
+    seed=mi;
+    return mi;
+  }
+
+  //hill-climb on the hull's vertex graph: on a convex hull, a vertex without better neighbor is the global maximum
+  uint mi = seed<n ? seed : 0;
+  double ms = __scalarProduct(dir, v+3*mi);
+  for(bool improved=true; improved;) {
+    improved=false;
+    const uintA& neigh=graph.p[mi];
+    for(uint j:neigh) {
+      double s = __scalarProduct(dir, v+3*j);
+      if(s>ms) { ms=s; mi=j; improved=true; }
     }
   }
-
-#endif
+  seed=mi;
+  return mi;
 }
 
 void rai::Mesh::supportMargin(uintA& verts, const arr& dir, double margin, int initialization) {
@@ -38,7 +38,12 @@ struct Mesh : GLDrawer {
   int texture=-1;       ///< GL texture name created with glBindTexture
 
   uintAA graph;         ///< for every vertex, the set of neighboring vertices
+  intA graphRings;      ///< the same graph in libGJK's ring format (offsets, then -1-terminated neighbor lists)
+  bool isConvex=false;  ///< V,T are a convex hull (set by makeConvexHull) -> support may hill-climb on the graph
   shared_ptr<ANN> ann;
+  shared_ptr<Mesh> lod;  ///< (optional) coarse level: few of the vertices, whose hull inflated by lodMargin contains this mesh (see makeLOD); dropped by touchV
+  double lodMargin=0.;
+  uint revision=0;      ///< unique number of the current vertices V (new on construction and on every change by the methods below): caches keyed on a mesh compare it
 
   rai::Transformation glX; ///< transform (only used for drawing! Otherwise use applyOnPoints)  (optional)
 
@@ -71,6 +76,7 @@ struct Mesh : GLDrawer {
   void setGrid(uint X, uint Y);
 
   /// @name transform and modify
+  void touchV(); ///< to be called after writing V directly: gives the mesh a new revision and drops its coarse level (lod)
   void subDivide();
   void subDivide(uint tri);
   void scale(double f);
@@ -87,6 +93,7 @@ struct Mesh : GLDrawer {
 
   /// @name support function
   uint support(const double* dir);
+  uint support(const double* dir, uint& seed) const; ///< warm-started from (and updating) a caller-held seed vertex
   void supportMargin(uintA& verts, const arr& dir, double margin, int initialization=-1);
 
   /// @name internal computations & cleanup
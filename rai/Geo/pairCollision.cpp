@@ -29,8 +29,10 @@ extern "C" {
 #  define FCLmode
 #endif
 
-PairCollision::PairCollision(rai::Mesh& _mesh1, rai::Mesh& _mesh2, const rai::Transformation& _t1, const rai::Transformation& _t2, double rad1, double rad2)
-  : mesh1(&_mesh1), mesh2(&_mesh2), t1(&_t1), t2(&_t2), rad1(rad1), rad2(rad2) {
+double PairCollision::lodDistance = .1;
+
+PairCollision::PairCollision(rai::Mesh& _mesh1, rai::Mesh& _mesh2, const rai::Transformation& _t1, const rai::Transformation& _t2, double rad1, double rad2, PairCollisionCache* cache, bool distanceBound)
+  : mesh1(&_mesh1), mesh2(&_mesh2), t1(&_t1), t2(&_t2), rad1(rad1), rad2(rad2), cache(cache), distanceBound(distanceBound) {
 
   distance=-1.;
 
@@ -58,15 +60,25 @@ PairCollision::PairCollision(rai::Mesh& _mesh1, rai::Mesh& _mesh2, const rai::Tr
     return;
   }
 
+  if(cache && cache->recall(*this)) return;
 
-#ifdef FCLmode
-  //THIS IS COSTLY! DO WITHIN THE SUPPORT FUNCTION?
-  rai::Mesh M1(*mesh1); if(!t1->isZero()) t1->applyOnPointArray(M1.V);
-  rai::Mesh M2(*mesh2); if(!t2->isZero()) t2->applyOnPointArray(M2.V);
+  if(primitiveDistance()) {
+    if(cache) cache->store(*this);
+    return;
+  }
 
-  libccd(M1, M2, _ccdGJKIntersect);
+  if(distanceBound && (_mesh1.lod || _mesh2.lod) && coarseDistance()) {
+    if(cache) cache->store(*this);
+    return;
+  }
+
+#ifdef FCLmode
+  libccd(*mesh1, *mesh2, *t1, *t2, _ccdGJKIntersect);
 #else
   GJK_sqrDistance();
+  //libGJK may stop (sqrDistance<1e-8) with its simplex inside the hulls (cold, and more so warm-started): below 1e-4,
+  //only ask libccd whether the meshes intersect (the GJK witness points stay); if they do, the penetration is computed below
+  if(distance>1e-10 && distance<1e-4 && libccdIntersect(*mesh1, *mesh2, *t1, *t2)) distance=0.;
 #endif
 
   CHECK_EQ(distance, distance, "distance is nan");
@@ -76,14 +88,11 @@ PairCollision::PairCollision(rai::Mesh& _mesh1, rai::Mesh& _mesh2, const rai::Tr
 
 #ifndef FCLmode
   if(distance<1e-10) { //WARNING: Setting this to zero does not work when using
-    //THIS IS COSTLY! DO WITHIN THE SUPPORT FUNCTION?
-    rai::Mesh M1(*mesh1); if(!t1->isZero()) t1->applyOnPointArray(M1.V);
-    rai::Mesh M2(*mesh2); if(!t2->isZero()) t2->applyOnPointArray(M2.V);
-    libccd(M1, M2, _ccdMPRPenetration);
+    libccd(*mesh1, *mesh2, *t1, *t2, _ccdMPRPenetration);
   }
 #else
   if(distance<0.) {
-    libccd(M1, M2, _ccdMPRPenetration);
+    libccd(*mesh1, *mesh2, *t1, *t2, _ccdMPRPenetration);
   }
 #endif
 
@@ -106,6 +115,8 @@ PairCollision::PairCollision(rai::Mesh& _mesh1, rai::Mesh& _mesh2, const rai::Tr
 
   CHECK_GE(rai::sign(distance) * scalarProduct(normal, p1-p2), -1e-10, "");
 
+  if(cache) cache->store(*this);
+
   //in current state, the rad1, rad2, have not been used at all!!
 }
 
@@ -194,16 +205,43 @@ void PairCollision::write(std::ostream& os) const {
 }
 
 #ifdef RAI_CCD
+/// a mesh placed by a transformation, as seen by libccd: support points and center are returned in world coordinates,
+/// without copying or transforming the mesh itself
+struct TransformedMesh {
+  const rai::Mesh& m;
+  double R[9], p[3]; ///< rotation (row-major) and translation
+  double center[3];  ///< world coordinates of the vertex mean
+  uint& seed;        ///< warm start for the support hill-climbing
+
+  TransformedMesh(const rai::Mesh& m, const rai::Transformation& t, uint& seed) : m(m), seed(seed) {
+    t.rot.getMatrix(R);
+    p[0]=t.pos.x;  p[1]=t.pos.y;  p[2]=t.pos.z;
+    double c[3]= {0., 0., 0.};
+    for(uint i=0; i<m.V.d0; i++) for(uint k=0; k<3; k++) c[k] += m.V.p[3*i+k];
+    if(m.V.d0) for(uint k=0; k<3; k++) c[k] /= m.V.d0;
+    toWorld(center, c);
+  }
+
+  void toWorld(double* x, const double* v) const {
+    x[0] = R[0]*v[0] + R[1]*v[1] + R[2]*v[2] + p[0];
+    x[1] = R[3]*v[0] + R[4]*v[1] + R[5]*v[2] + p[1];
+    x[2] = R[6]*v[0] + R[7]*v[1] + R[8]*v[2] + p[2];
+  }
+
+  void vertex(arr& x, uint i) const { x.resize(1, 3); toWorld(x.p, m.V.p+3*i); }
+};
+
 void support_mesh(const void* _obj, const ccd_vec3_t* dir, ccd_vec3_t* v) {
-  rai::Mesh* m = (rai::Mesh*)_obj;
-  uint vertex = m->support(dir->v);
-  memmove(v->v, m->V.p+3*vertex, 3*m->V.sizeT);
+  TransformedMesh* tm = (TransformedMesh*)_obj;
+  const double* R=tm->R, *d=dir->v;
+  double dirLocal[3] = { R[0]*d[0]+R[3]*d[1]+R[6]*d[2], R[1]*d[0]+R[4]*d[1]+R[7]*d[2], R[2]*d[0]+R[5]*d[1]+R[8]*d[2] };
+  uint vertex = tm->m.support(dirLocal, tm->seed);
+  tm->toWorld(v->v, tm->m.V.p+3*vertex);
 }
 
-void center_mesh(const void* obj, ccd_vec3_t* center) {
-  rai::Mesh* m = (rai::Mesh*)obj;
-  rai::Vector c = m->getCenter();
-  memmove(center->v, &c.x, 3*sizeof(double));
+void center_mesh(const void* _obj, ccd_vec3_t* center) {
+  const TransformedMesh* tm = (const TransformedMesh*)_obj;
+  memmove(center->v, tm->center, 3*sizeof(double));
 }
 
 bool _equal(double* a, double* b) {
@@ -253,7 +291,10 @@ void _getSimplex(arr& S, ccd_vec3_t* simplex, const arr& mean) {
 
 }
 
-void PairCollision::libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method) {
+void PairCollision::libccd(const rai::Mesh& _m1, const rai::Mesh& _m2, const rai::Transformation& t1, const rai::Transformation& t2, CCDmethod method) {
+  uint _seed1=0, _seed2=0;
+  TransformedMesh m1(_m1, t1, cache?cache->seed1:_seed1), m2(_m2, t2, cache?cache->seed2:_seed2);
+
   ccd_t ccd;
   CCD_INIT(&ccd); // initialize ccd_t struct
 
@@ -275,9 +316,7 @@ void PairCollision::libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method) {
     int ret = ccdMPRPenetration(&m1, &m2, &ccd, &_depth, &_dir, &_pos, simplex);
     if(ret<0) {
       LOG(0) <<"WARNING: called MPR penetration for non intersecting meshes...";
-      m1._support_vertex = rnd(m1.V.d0);
-      m2._support_vertex = rnd(m2.V.d0);
-      libccd(m1, m2, _ccdGJKIntersect);
+      libccd(_m1, _m2, t1, t2, _ccdGJKIntersect);
       if(distance<0.) {
         LOG(0) <<"WARNING: but GJK says intersection";
         distance=0;
@@ -297,10 +336,10 @@ void PairCollision::libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method) {
     if(distance>-1e-10) return; //minimal penetration -> simplices below are not robust
 
     //grab simplex points
-    if(m1.V.d0==1) simplex1 = m1.V; //m1 is a point/sphere
-    else _getSimplex(simplex1, simplex, m1.getMean());
-    if(m2.V.d0==1) simplex2 = m2.V; //m2 is a point/sphere
-    else _getSimplex(simplex2, simplex+4, m2.getMean());
+    if(_m1.V.d0==1) m1.vertex(simplex1, 0); //m1 is a point/sphere
+    else _getSimplex(simplex1, simplex, arr(m1.center, 3, true));
+    if(_m2.V.d0==1) m2.vertex(simplex2, 0); //m2 is a point/sphere
+    else _getSimplex(simplex2, simplex+4, arr(m2.center, 3, true));
     if(simplex1.d0>3) simplex1.resizeCopy(3, 3);
     if(simplex2.d0>3) simplex2.resizeCopy(3, 3);
 
@@ -308,9 +347,7 @@ void PairCollision::libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method) {
       int ret = ccdGJKPenetration(&m1, &m2, &ccd, &_depth, &_dir, &_pos);
       if(ret<0) {
         LOG(0) <<"WARNING: called MPR penetration for non intersecting meshes...";
-        m1._support_vertex = rnd(m1.V.d0);
-        m2._support_vertex = rnd(m2.V.d0);
-        libccd(m1, m2, _ccdGJKIntersect);
+        libccd(_m1, _m2, t1, t2, _ccdGJKIntersect);
         if(distance<0.) {
           LOG(0) <<"WARNING: but GJK says intersection";
           distance=0;
@@ -418,19 +455,278 @@ void PairCollision::libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method) {
 //  }
 //  HALT("should not be here");
 }
+
+bool PairCollision::libccdIntersect(const rai::Mesh& _m1, const rai::Mesh& _m2, const rai::Transformation& t1, const rai::Transformation& t2) {
+  uint _seed1=0, _seed2=0;
+  TransformedMesh m1(_m1, t1, cache?cache->seed1:_seed1), m2(_m2, t2, cache?cache->seed2:_seed2);
+
+  ccd_t ccd;
+  CCD_INIT(&ccd);
+  ccd.support1       = support_mesh;
+  ccd.support2       = support_mesh;
+  ccd.max_iterations = 100;
+  ccd.center1       = center_mesh;
+  ccd.center2       = center_mesh;
+
+  ccd_vec3_t _v1, _v2;
+  ccd_vec3_t simplex[8];
+  return ccdGJKIntersect(&m1, &m2, &ccd, &_v1, &_v2, simplex);
+}
 #else
-void PairCollision::libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method) {
+void PairCollision::libccd(const rai::Mesh& m1, const rai::Mesh& m2, const rai::Transformation& t1, const rai::Transformation& t2, CCDmethod method) {
+  NICO
+}
+
+bool PairCollision::libccdIntersect(const rai::Mesh& m1, const rai::Mesh& m2, const rai::Transformation& t1, const rai::Transformation& t2) {
   NICO
+  return false;
+}
+#endif
+
+//===========================================================================
+//
+// closed-form kernels for the cores of spheres (point), capsules (segment) and (ss)boxes (axis-aligned box)
+//
+
+namespace {
+
+enum PrimitiveType { PT_none, PT_point, PT_segment, PT_box };
+
+struct Primitive {
+  PrimitiveType type=PT_none;
+  rai::Vector a, b;               ///< point, or segment end points (world)
+  const rai::Transformation* X;   ///< pose
+  double h[3];                    ///< box half extents
+
+  Primitive(const rai::Mesh& m, const rai::Transformation& _X) : X(&_X) {
+    const arr& V=m.V;
+    if(V.d0==1) { type=PT_point;  a = _X*rai::Vector(V.p); }
+    else if(V.d0==2) { type=PT_segment;  a = _X*rai::Vector(V.p);  b = _X*rai::Vector(V.p+3); }
+    else if(V.d0==8) { //exactly the 8 corners of a centered axis-aligned box?
+      for(uint k=0; k<3; k++) { h[k]=fabs(V.p[k]);  if(h[k]<1e-12) return; }
+      uint corners=0;
+      for(uint i=0; i<8; i++) {
+        const double* v=V.p+3*i;
+        for(uint k=0; k<3; k++) if(fabs(fabs(v[k])-h[k])>1e-12*h[k]) return;
+        corners |= 1<<((v[0]>0.) + 2*(v[1]>0.) + 4*(v[2]>0.));
+      }
+      if(corners==255) type=PT_box;
+    }
+  }
+
+  rai::Vector corner(int sx, int sy, int sz) const { return rai::Vector(sx*h[0], sy*h[1], sz*h[2]); } ///< in box coordinates
+};
+
+/// the closest feature of a primitive: a vertex, an edge or (three corners of) a face
+struct Feature {
+  rai::Vector v[3];
+  uint n=0;
+  void set(const rai::Vector& a) { v[0]=a;  n=1; }
+  void set(const rai::Vector& a, const rai::Vector& b) { v[0]=a;  v[1]=b;  n=2; }
+  void getSimplex(arr& S, const rai::Transformation* X=0) const {
+    S.resize(n, 3);
+    for(uint i=0; i<n; i++) {
+      rai::Vector w = X ? (*X)*v[i] : v[i];
+      S(i, 0)=w.x;  S(i, 1)=w.y;  S(i, 2)=w.z;
+    }
+  }
+};
+
+//closest points a0+s(a1-a0) and b0+t(b1-b0) between two segments (Ericson, Real-Time Collision Detection, 5.1.9);
+//returns the squared distance (plain doubles and inlined min/max: this is the inner loop of segment-box)
+double closestSegmentSegment(double& s, double& t, const double* a0, const double* a1, const double* b0, const double* b1) {
+  double d1[3], d2[3], r[3];
+  for(uint k=0; k<3; k++) { d1[k]=a1[k]-a0[k];  d2[k]=b1[k]-b0[k];  r[k]=a0[k]-b0[k]; }
+  double a=d1[0]*d1[0]+d1[1]*d1[1]+d1[2]*d1[2], e=d2[0]*d2[0]+d2[1]*d2[1]+d2[2]*d2[2], f=d2[0]*r[0]+d2[1]*r[1]+d2[2]*r[2];
+  if(a<=1e-20 && e<=1e-20) { s=t=0.; }
+  else if(a<=1e-20) { s=0.;  t=std::min(1., std::max(0., f/e)); }
+  else {
+    double c=d1[0]*r[0]+d1[1]*r[1]+d1[2]*r[2];
+    if(e<=1e-20) { t=0.;  s=std::min(1., std::max(0., -c/a)); }
+    else {
+      double b=d1[0]*d2[0]+d1[1]*d2[1]+d1[2]*d2[2], denom=a*e-b*b;
+      s = denom>1e-20 ? std::min(1., std::max(0., (b*f-c*e)/denom)) : 0.;
+      t = (b*s+f)/e;
+      if(t<0.) { t=0.;  s=std::min(1., std::max(0., -c/a)); }
+      else if(t>1.) { t=1.;  s=std::min(1., std::max(0., (b-c)/a)); }
+    }
+  }
+  double D=0.;
+  for(uint k=0; k<3; k++) { double x=r[k] + s*d1[k] - t*d2[k];  D += x*x; }
+  return D;
+}
+
+//the part of segment a0a1 supporting the interpolation parameter s: an end point, or the whole segment
+void segmentFeature(Feature& F, double s, const rai::Vector& a0, const rai::Vector& a1) {
+  if(s<=0.) F.set(a0);
+  else if(s>=1.) F.set(a1);
+  else F.set(a0, a1);
+}
+
+//closest point c on a box to q (in box coordinates), and the supporting feature;
+//for inside points, the closest point on the nearest face; returns the signed distance
+double closestPointBox(rai::Vector& c, Feature& F, const rai::Vector& q, const Primitive& B) {
+  const double* qq=&q.x;
+  double cl[3];
+  int sgn[3];
+  uint clamped=0;
+  for(uint k=0; k<3; k++) {
+    sgn[k] = qq[k]>0. ? 1 : -1;
+    cl[k] = qq[k];
+    if(fabs(qq[k])>=B.h[k]) { cl[k]=sgn[k]*B.h[k];  clamped |= 1<<k; }
+  }
+  double d;
+  if(!clamped) { //inside: project onto the nearest face
+    uint k=0;
+    for(uint j=1; j<3; j++) if(B.h[j]-fabs(qq[j]) < B.h[k]-fabs(qq[k])) k=j;
+    cl[k]=sgn[k]*B.h[k];
+    clamped = 1<<k;
+    d = -(B.h[k]-fabs(qq[k]));
+  } else {
+    d = sqrt((qq[0]-cl[0])*(qq[0]-cl[0]) + (qq[1]-cl[1])*(qq[1]-cl[1]) + (qq[2]-cl[2])*(qq[2]-cl[2]));
+  }
+  c.set(cl[0], cl[1], cl[2]);
+
+  //-- the supporting feature: corner (3 clamped axes), edge (2), or face (1; three of its corners)
+  uint nClamped = (clamped&1) + ((clamped>>1)&1) + ((clamped>>2)&1);
+  if(nClamped==3) F.set(c);
+  else if(nClamped==2) {
+    uint k = !(clamped&1) ? 0 : !(clamped&2) ? 1 : 2;
+    int s0[3] = {sgn[0], sgn[1], sgn[2]}, s1[3] = {sgn[0], sgn[1], sgn[2]};
+    s0[k]=1;  s1[k]=-1;
+    F.set(B.corner(s0[0], s0[1], s0[2]), B.corner(s1[0], s1[1], s1[2]));
+  } else {
+    uint k = (clamped&1) ? 0 : (clamped&2) ? 1 : 2, i=(k+1)%3, j=(k+2)%3;
+    for(uint m=0; m<3; m++) {
+      int s[3];
+      s[k]=sgn[k];  s[i] = m==1 ? -1 : 1;  s[j] = m==2 ? -1 : 1;
+      F.v[m] = B.corner(s[0], s[1], s[2]);
+    }
+    F.n=3;
+  }
+  return d;
+}
+
+//does the segment pq (in box coordinates) intersect the box? (slab test)
+bool segmentIntersectsBox(const rai::Vector& p, const rai::Vector& q, const Primitive& B) {
+  double t0=0., t1=1.;
+  for(uint k=0; k<3; k++) {
+    double pk=(&p.x)[k], dk=(&q.x)[k]-pk;
+    if(fabs(dk)<1e-20) { if(fabs(pk)>B.h[k]) return false;  continue; }
+    double u=(-B.h[k]-pk)/dk, v=(B.h[k]-pk)/dk;
+    if(u>v) std::swap(u, v);
+    t0=std::max(t0, u);  t1=std::min(t1, v);
+    if(t0>t1) return false;
+  }
+  return true;
+}
+
+}
+
+bool PairCollision::primitiveDistance() {
+  Primitive A(*mesh1, *t1), B(*mesh2, *t2);
+  if(A.type==PT_none || B.type==PT_none || (A.type==PT_box && B.type==PT_box)) return false;
+  bool swapped = A.type==PT_box;
+  if(swapped) std::swap(A, B);
+  //now A is a point or segment; boxes are handled in box coordinates (F2 and c2 then need the transformation X2)
+
+  rai::Vector c1, c2;
+  Feature F1, F2;
+  const rai::Transformation* X2=0;
+  double d, s, t;
+  if(B.type!=PT_box) { //point-point, point-segment, segment-point, segment-segment: all are segment-segment
+    rai::Vector b1 = B.type==PT_point ? B.a : B.b;
+    rai::Vector a1 = A.type==PT_point ? A.a : A.b;
+    d=sqrt(closestSegmentSegment(s, t, &A.a.x, &a1.x, &B.a.x, &b1.x));
+    c1 = A.a + s*(a1-A.a);
+    c2 = B.a + t*(b1-B.a);
+    if(A.type==PT_point) F1.set(c1); else segmentFeature(F1, s, A.a, A.b);
+    if(B.type==PT_point) F2.set(c2); else segmentFeature(F2, t, B.a, B.b);
+  } else if(A.type==PT_point) { //point-box
+    X2=B.X;
+    c1=A.a;
+    F1.set(c1);
+    d=closestPointBox(c2, F2, *X2/A.a, B);
+  } else { //segment-box: closest to an end point, or to one of the 12 edges
+    X2=B.X;
+    rai::Vector a0 = *X2/A.a, a1 = *X2/A.b, x2;
+    if(segmentIntersectsBox(a0, a1, B)) return false; //penetration: leave to MPR
+    Feature F;
+    d=closestPointBox(c2, F2, a0, B);
+    s=0.;
+    double db=closestPointBox(x2, F, a1, B);
+    if(db<d) { d=db;  c2=x2;  F2=F;  s=1.; }
+    double lo[3], hi[3]; //bounding box of the segment, to skip edges whose box is farther than d
+    for(uint k=0; k<3; k++) { lo[k]=std::min((&a0.x)[k], (&a1.x)[k]);  hi[k]=std::max((&a0.x)[k], (&a1.x)[k]); }
+    for(uint k=0; k<3; k++) {
+      uint i=(k+1)%3, j=(k+2)%3;
+      for(int si=-1; si<=1; si+=2) for(int sj=-1; sj<=1; sj+=2) {
+          double b0[3], b1[3], se, te;
+          b0[k]=-B.h[k];  b1[k]=B.h[k];  b0[i]=b1[i]=si*B.h[i];  b0[j]=b1[j]=sj*B.h[j];
+          double gap=0.;
+          for(uint m=0; m<3; m++) { double g=std::max(0., std::max(lo[m]-b1[m], b0[m]-hi[m]));  gap += g*g; }
+          if(gap>=d*d) continue;
+          double de=closestSegmentSegment(se, te, &a0.x, &a1.x, b0, b1);
+          if(de<d*d) {
+            d=sqrt(de);  s=se;
+            rai::Vector e0(b0), e1(b1);
+            c2 = e0 + te*(e1-e0);
+            segmentFeature(F2, te, e0, e1);
+          }
+        }
+    }
+    c1 = A.a + s*(A.b-A.a);
+    segmentFeature(F1, s, A.a, A.b);
+  }
+  if(fabs(d)<1e-10) return false; //touching: no well-defined normal -> leave to GJK/MPR
+  if(X2) c2 = (*X2)*c2;
+
+  p1.resize(3);  p2.resize(3);
+  if(swapped) {
+    memmove(p1.p, &c2.x, 3*p1.sizeT);  memmove(p2.p, &c1.x, 3*p2.sizeT);
+    F2.getSimplex(simplex1, X2);  F1.getSimplex(simplex2);
+  } else {
+    memmove(p1.p, &c1.x, 3*p1.sizeT);  memmove(p2.p, &c2.x, 3*p2.sizeT);
+    F1.getSimplex(simplex1);  F2.getSimplex(simplex2, X2);
+  }
+  distance=d;
+  normal=(p1-p2)/distance;
+  return true;
 }
+
+bool PairCollision::coarseDistance() {
+#ifdef RAI_GJK
+  //GJK on the coarse levels, without the cache (its seeds refer to the full meshes)
+  const rai::Mesh *full1=mesh1, *full2=mesh2;
+  PairCollisionCache* _cache=cache;
+  double margin1=0., margin2=0.;
+  if(full1->lod) { mesh1=full1->lod.get();  margin1=full1->lodMargin; }
+  if(full2->lod) { mesh2=full2->lod.get();  margin2=full2->lodMargin; }
+  cache=0;
+  GJK_sqrDistance();
+  mesh1=full1;  mesh2=full2;  cache=_cache;
+
+  //the coarse hulls inflated by their margins contain the meshes: their distance is a lower bound
+  if(distance-margin1-margin2-rad1-rad2 <= lodDistance) return false;
+  distance -= margin1+margin2;
+  p1 -= margin1*normal;
+  p2 += margin2*normal;
+  return true;
+#else
+  return false;
 #endif
+}
 
 void PairCollision::GJK_sqrDistance() {
 #ifdef RAI_GJK
   // convert meshes to 'Object_structures'
   Object_structure m1, m2;
   rai::Array<double*> Vhelp1, Vhelp2;
-  m1.numpoints = mesh1->V.d0;  m1.vertices = mesh1->V.getCarray(Vhelp1);  m1.rings=nullptr; //TODO: rings would make it faster
+  m1.numpoints = mesh1->V.d0;  m1.vertices = mesh1->V.getCarray(Vhelp1);  m1.rings=nullptr;
   m2.numpoints = mesh2->V.d0;  m2.vertices = mesh2->V.getCarray(Vhelp2);  m2.rings=nullptr;
+  //on larger hulls, let GJK hill-climb along the edges (warm-started from its previous support vertex)
+  if(mesh1->isConvex && mesh1->V.d0>32 && mesh1->graphRings.N) m1.rings = (int*)mesh1->graphRings.p;
+  if(mesh2->isConvex && mesh2->V.d0>32 && mesh2->graphRings.N) m2.rings = (int*)mesh2->graphRings.p;
 
   // convert transformations to affine matrices
   arr T1, T2;
@@ -438,11 +734,24 @@ void PairCollision::GJK_sqrDistance() {
   if(!!t1) {  T1=t1->getAffineMatrix();  T1.getCarray(Thelp1);  }
   if(!!t2) {  T2=t2->getAffineMatrix();  T2.getCarray(Thelp2);  }
 
-  // call GJK
-  simplex_point simplex;
+  // call GJK, warm-started from the cached simplex of the previous query
+  simplex_point _simplex, *simplex=&_simplex;
+  int useSeed=0;
+  if(cache) {
+    if(!cache->gjk) cache->gjk = make_shared<simplex_point>();
+    simplex = cache->gjk.get();
+    useSeed = cache->gjkValid;
+    if(useSeed && simplex->npts>3) { //a full (penetration) simplex can't be extended -> restart from the last support pair only
+      simplex->npts = 1;
+      simplex->simplex1[0] = simplex->last_best1;
+      simplex->simplex2[0] = simplex->last_best2;
+      simplex->lambdas[0] = 1.;
+    }
+  }
   p1.resize(3).setZero();
   p2.resize(3).setZero();
-  gjk_distance(&m1, Thelp1.p, &m2, Thelp2.p, p1.p, p2.p, &simplex, 0);
+  gjk_distance(&m1, Thelp1.p, &m2, Thelp2.p, p1.p, p2.p, simplex, useSeed);
+  if(cache) cache->gjkValid=true;
 
   normal = p1-p2;
   distance = length(normal);
@@ -451,23 +760,286 @@ void PairCollision::GJK_sqrDistance() {
   //grab simplex points
   simplex1.resize(0, 3);
   simplex2.resize(0, 3);
-  if(simplex.npts>=1) {
-    simplex1.append(arr(simplex.coords1[0], 3, true));
-    simplex2.append(arr(simplex.coords2[0], 3, true));
+  if(simplex->npts>=1) {
+    simplex1.append(arr(simplex->coords1[0], 3, true));
+    simplex2.append(arr(simplex->coords2[0], 3, true));
   }
-  if(simplex.npts>=2) {
-    if(simplex.simplex1[1]!=simplex.simplex1[0]) simplex1.append(arr(simplex.coords1[1], 3, true));
-    if(simplex.simplex2[1]!=simplex.simplex2[0]) simplex2.append(arr(simplex.coords2[1], 3, true));
+  if(simplex->npts>=2) {
+    if(simplex->simplex1[1]!=simplex->simplex1[0]) simplex1.append(arr(simplex->coords1[1], 3, true));
+    if(simplex->simplex2[1]!=simplex->simplex2[0]) simplex2.append(arr(simplex->coords2[1], 3, true));
   }
-  if(simplex.npts>=3) {
-    if(simplex.simplex1[2]!=simplex.simplex1[0] && simplex.simplex1[2]!=simplex.simplex1[1]) simplex1.append(arr(simplex.coords1[2], 3, true));
-    if(simplex.simplex2[2]!=simplex.simplex2[0] && simplex.simplex2[2]!=simplex.simplex2[1]) simplex2.append(arr(simplex.coords2[2], 3, true));
+  if(simplex->npts>=3) {
+    if(simplex->simplex1[2]!=simplex->simplex1[0] && simplex->simplex1[2]!=simplex->simplex1[1]) simplex1.append(arr(simplex->coords1[2], 3, true));
+    if(simplex->simplex2[2]!=simplex->simplex2[0] && simplex->simplex2[2]!=simplex->simplex2[1]) simplex2.append(arr(simplex->coords2[2], 3, true));
   }
 #else
   NICO
 #endif
 }
 
+//===========================================================================
+
+void makeLOD(rai::Mesh& mesh) {
+  mesh.lod.reset();
+  mesh.lodMargin=0.;
+#ifdef RAI_GJK
+  uintA ids;
+  double dir[3];
+  for(int x=-1; x<=1; x++) for(int y=-1; y<=1; y++) for(int z=-1; z<=1; z++) {
+        if(!x && !y && !z) continue;
+        dir[0]=x;  dir[1]=y;  dir[2]=z;
+        ids.setAppend(mesh.support(dir));
+      }
+  if(2*ids.N>mesh.V.d0) return; //not worth a coarse level
+
+  auto lod = make_shared<rai::Mesh>();
+  lod->V.resize(ids.N, 3);
+  for(uint i=0; i<ids.N; i++) lod->V[i] = mesh.V[ids(i)];
+
+  //-- margin: the largest distance of a vertex to the coarse hull
+  Object_structure hull, point;
+  rai::Array<double*> Vhelp;
+  hull.numpoints = lod->V.d0;  hull.vertices = lod->V.getCarray(Vhelp);  hull.rings=nullptr;
+  point.numpoints = 1;  point.rings=nullptr;
+  double margin=0., w1[3], w2[3];
+  simplex_point simplex;
+  for(uint i=0; i<mesh.V.d0; i++) {
+    double* v = &mesh.V(i, 0);
+    point.vertices = &v;
+    double d = gjk_distance(&hull, 0, &point, 0, w1, w2, &simplex, 0);
+    if(d>margin) margin=d;
+  }
+  mesh.lod = lod;
+  mesh.lodMargin = sqrt(margin);
+#endif
+}
+
+//===========================================================================
+
+namespace {
+
+struct GJKVertex { double w[3], a[3], b[3]; }; //w=a-b, with a on obj1, b on obj2
+
+inline double dot3(const double* x, const double* y) { return x[0]*y[0]+x[1]*y[1]+x[2]*y[2]; }
+
+//closest point to the origin on the triangle W[i],W[j],W[k] (Ericson, Real-Time Collision Detection, 5.1.5): barycentric weights in l
+void closestOnTriangle(double* l, const GJKVertex* W, uint i, uint j, uint k) {
+  const double *a=W[i].w, *b=W[j].w, *c=W[k].w;
+  double ab[3], ac[3];
+  for(uint d=0; d<3; d++) { ab[d]=b[d]-a[d];  ac[d]=c[d]-a[d]; }
+  double d1=-dot3(ab, a), d2=-dot3(ac, a);
+  if(d1<=0. && d2<=0.) { l[0]=1.;  l[1]=l[2]=0.;  return; }
+  double d3=-dot3(ab, b), d4=-dot3(ac, b);
+  if(d3>=0. && d4<=d3) { l[1]=1.;  l[0]=l[2]=0.;  return; }
+  double vc=d1*d4-d3*d2;
+  if(vc<=0. && d1>=0. && d3<=0.) { double v=d1/(d1-d3);  l[0]=1.-v;  l[1]=v;  l[2]=0.;  return; }
+  double d5=-dot3(ab, c), d6=-dot3(ac, c);
+  if(d6>=0. && d5<=d6) { l[2]=1.;  l[0]=l[1]=0.;  return; }
+  double vb=d5*d2-d1*d6;
+  if(vb<=0. && d2>=0. && d6<=0.) { double w=d2/(d2-d6);  l[0]=1.-w;  l[1]=0.;  l[2]=w;  return; }
+  double va=d3*d6-d5*d4;
+  if(va<=0. && (d4-d3)>=0. && (d5-d6)>=0.) { double w=(d4-d3)/((d4-d3)+(d5-d6));  l[0]=0.;  l[1]=1.-w;  l[2]=w;  return; }
+  double denom=1./(va+vb+vc);
+  l[1]=vb*denom;  l[2]=vc*denom;  l[0]=1.-l[1]-l[2];
+}
+
+//reduces the simplex W[0..n-1] to the vertices supporting its point closest to the origin (weights l, point v);
+//returns false if the origin is inside the tetrahedron
+bool closestOnSimplex(GJKVertex* W, uint& n, double* l, double* v) {
+  double best[4]= {1., 0., 0., 0.};
+  if(n==2) {
+    double ab[3]= {W[1].w[0]-W[0].w[0], W[1].w[1]-W[0].w[1], W[1].w[2]-W[0].w[2]};
+    double t=-dot3(W[0].w, ab)/dot3(ab, ab);
+    if(t<0.) t=0.;
+    if(t>1.) t=1.;
+    best[0]=1.-t;  best[1]=t;
+  } else if(n==3) {
+    closestOnTriangle(best, W, 0, 1, 2);
+  } else if(n==4) {
+    static const uint face[4][4]= {{0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 3, 1}, {1, 2, 3, 0}}; //3 vertices and the opposite one
+    double bestSqr=-1., t[3], x[3];
+    for(uint f=0; f<4; f++) {
+      const double *a=W[face[f][0]].w, *b=W[face[f][1]].w, *c=W[face[f][2]].w, *o=W[face[f][3]].w;
+      double ab[3], ac[3], ao[3], nrm[3];
+      for(uint d=0; d<3; d++) { ab[d]=b[d]-a[d];  ac[d]=c[d]-a[d];  ao[d]=o[d]-a[d]; }
+      nrm[0]=ab[1]*ac[2]-ab[2]*ac[1];  nrm[1]=ab[2]*ac[0]-ab[0]*ac[2];  nrm[2]=ab[0]*ac[1]-ab[1]*ac[0];
+      if(-dot3(nrm, a)*dot3(nrm, ao)>0.) continue; //the origin is on the same side as the opposite vertex
+      closestOnTriangle(t, W, face[f][0], face[f][1], face[f][2]);
+      for(uint d=0; d<3; d++) x[d]=t[0]*a[d]+t[1]*b[d]+t[2]*c[d];
+      double sqr=dot3(x, x);
+      if(bestSqr<0. || sqr<bestSqr) {
+        bestSqr=sqr;
+        for(uint i=0; i<4; i++) best[i]=0.;
+        for(uint i=0; i<3; i++) best[face[f][i]]=t[i];
+      }
+    }
+    if(bestSqr<0.) return false;
+  }
+
+  //-- keep the supporting vertices
+  uint m=0;
+  for(uint i=0; i<n; i++) if(best[i]>0.) { W[m]=W[i];  l[m]=best[i];  m++; }
+  if(!m) { l[0]=1.;  m=1; }
+  n=m;
+  for(uint d=0; d<3; d++) { v[d]=0.;  for(uint i=0; i<n; i++) v[d]+=l[i]*W[i].w[d]; }
+  return true;
+}
+
+struct GJKObject {
+  const rai::Mesh& m;
+  double R[9], t[3];
+  uint seed=0;
+  GJKObject(const rai::Mesh& m, const rai::Transformation& X) : m(m) { X.rot.getMatrix(R);  t[0]=X.pos.x;  t[1]=X.pos.y;  t[2]=X.pos.z; }
+  void support(double* x, const double* dir) { //world support point in world direction dir
+    double d[3]= {R[0]*dir[0]+R[3]*dir[1]+R[6]*dir[2], R[1]*dir[0]+R[4]*dir[1]+R[7]*dir[2], R[2]*dir[0]+R[5]*dir[1]+R[8]*dir[2]};
+    const double* v=m.V.p+3*m.support(d, seed);
+    for(uint k=0; k<3; k++) x[k]=t[k]+R[3*k]*v[0]+R[3*k+1]*v[1]+R[3*k+2]*v[2];
+  }
+};
+
+//GJK distance of the convex hulls; returns false if they overlap
+bool gjkDistance(double& dist, double* p1, double* p2, GJKObject& A, GJKObject& B) {
+  GJKVertex W[4];
+  double l[4]= {1., 0., 0., 0.}, v[3], dir[3];
+  uint n=1;
+  auto support = [&](GJKVertex& w, const double* d) {
+    double nd[3]= {-d[0], -d[1], -d[2]};
+    A.support(w.a, d);
+    B.support(w.b, nd);
+    for(uint k=0; k<3; k++) w.w[k]=w.a[k]-w.b[k];
+  };
+  for(uint k=0; k<3; k++) dir[k]=B.t[k]-A.t[k];
+  if(dot3(dir, dir)<1e-20) dir[0]=1.;
+  support(W[0], dir);
+  for(uint k=0; k<3; k++) v[k]=W[0].w[k];
+
+  bool separated=true;
+  for(uint iter=0; iter<64; iter++) {
+    double vv=dot3(v, v);
+    if(vv<1e-20) { separated=false;  break; }
+    for(uint k=0; k<3; k++) dir[k]=-v[k];
+    GJKVertex& w=W[n];
+    support(w, dir);
+    if(vv-dot3(v, w.w) <= 1e-12*vv) break; //no progress towards the origin: v is the closest point
+    bool known=false;
+    for(uint i=0; i<n; i++) if(!memcmp(W[i].w, w.w, 3*sizeof(double))) known=true;
+    if(known) break;
+    n++;
+    if(!closestOnSimplex(W, n, l, v)) { separated=false;  break; }
+  }
+
+  for(uint k=0; k<3; k++) {
+    p1[k]=p2[k]=0.;
+    for(uint i=0; i<n; i++) { p1[k]+=l[i]*W[i].a[k];  p2[k]+=l[i]*W[i].b[k]; }
+  }
+  dist = separated ? sqrt(dot3(v, v)) : 0.;
+  return separated;
+}
+
+}
+
+void PairCollisionBatch::clear() {
+  meshes1.clear();  meshes2.clear();
+  poses1.clear();  poses2.clear();
+  rad1.clear();  rad2.clear();
+}
+
+uint PairCollisionBatch::add(const rai::Mesh& mesh1, const rai::Mesh& mesh2, const rai::Transformation& X1, const rai::Transformation& X2, double r1, double r2) {
+  CHECK(mesh1.V.N && mesh2.V.N, "empty mesh");
+  meshes1.append(&mesh1);  meshes2.append(&mesh2);
+  poses1.append(&X1);  poses2.append(&X2);
+  rad1.append(r1);  rad2.append(r2);
+  return meshes1.N-1;
+}
+
+void PairCollisionBatch::compute() {
+  uint n=meshes1.N;
+  distance.resize(n);
+  p1.resize(n, 3);
+  p2.resize(n, 3);
+  normal.resize(n, 3).setZero();
+  overlap.resize(n);
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for(uint i=0; i<n; i++) {
+    GJKObject A(*meshes1.p[i], *poses1.p[i]), B(*meshes2.p[i], *poses2.p[i]);
+    double d, *a=p1.p+3*i, *b=p2.p+3*i, *nrm=normal.p+3*i;
+    overlap.p[i] = !gjkDistance(d, a, b, A, B);
+    if(!overlap.p[i] && d>1e-10) {
+      for(uint k=0; k<3; k++) {
+        nrm[k]=(a[k]-b[k])/d;
+        a[k]-=rad1.p[i]*nrm[k];
+        b[k]+=rad2.p[i]*nrm[k];
+      }
+    }
+    distance.p[i] = d-rad1.p[i]-rad2.p[i];
+  }
+}
+
+//===========================================================================
+
+static bool _samePose(const rai::Transformation& a, const rai::Transformation& b, double eps=0.) {
+  return fabs(a.pos.x-b.pos.x)<=eps && fabs(a.pos.y-b.pos.y)<=eps && fabs(a.pos.z-b.pos.z)<=eps
+         && fabs(a.rot.w-b.rot.w)<=eps && fabs(a.rot.x-b.rot.x)<=eps && fabs(a.rot.y-b.rot.y)<=eps && fabs(a.rot.z-b.rot.z)<=eps;
+}
+
+//moves a world point rigidly with obj1, from pose 'from' to pose 'to'
+static void _movePoint(double* x, const rai::Transformation& from, const rai::Transformation& to) {
+  rai::Vector v = to.pos + to.rot*(from.rot/(rai::Vector(x) - from.pos));
+  x[0]=v.x;  x[1]=v.y;  x[2]=v.z;
+}
+
+bool PairCollisionCache::recall(PairCollision& coll) {
+  queries++;
+  const rai::Mesh *m1=coll.mesh1, *m2=coll.mesh2;
+  if(mesh1!=m1 || mesh2!=m2
+      || rev1!=m1->revision || rev2!=m2->revision
+      || Vp1!=m1->V.p || Vp2!=m2->V.p || V1!=m1->V.N || V2!=m2->V.N) {
+    clear();
+    mesh1=m1;  mesh2=m2;
+    rev1=m1->revision;  rev2=m2->revision;
+    Vp1=m1->V.p;  Vp2=m2->V.p;
+    V1=m1->V.N;  V2=m2->V.N;
+    seed1=seed2=0;
+    return false;
+  }
+  if(!valid) return false;
+
+  const rai::Transformation& T1=*coll.t1, &T2=*coll.t2;
+  if(_samePose(T1, t1) && _samePose(T2, t2)) {
+    //identical poses: the identical result
+    coll.p1=p1;  coll.p2=p2;  coll.normal=normal;
+    coll.simplex1=simplex1;  coll.simplex2=simplex2;
+  } else {
+    rai::Transformation R;
+    R.setDifference(T1, T2);
+    if(!_samePose(R, rel, 1e-12)) return false;
+    //same relative pose: the last result, moved rigidly along with obj1
+    coll.p1=p1;  coll.p2=p2;  coll.simplex1=simplex1;  coll.simplex2=simplex2;
+    _movePoint(coll.p1.p, t1, T1);
+    _movePoint(coll.p2.p, t1, T1);
+    for(uint i=0; i<coll.simplex1.d0; i++) _movePoint(&coll.simplex1(i, 0), t1, T1);
+    for(uint i=0; i<coll.simplex2.d0; i++) _movePoint(&coll.simplex2(i, 0), t1, T1);
+    rai::Vector n = T1.rot*(t1.rot/rai::Vector(normal));
+    coll.normal = n.getArr();
+  }
+  coll.distance=distance;
+  reused++;
+  return true;
+}
+
+void PairCollisionCache::store(const PairCollision& coll) {
+  CHECK(mesh1==coll.mesh1 && mesh2==coll.mesh2, "cache was not recalled for this pair");
+  t1=*coll.t1;  t2=*coll.t2;
+  rel.setDifference(t1, t2);
+  distance=coll.distance;
+  rai::ArenaPause heap; //the cache outlives the feature evaluation: don't pin an arena chunk
+  p1=coll.p1;  p2=coll.p2;  normal=coll.normal;
+  simplex1=coll.simplex1;  simplex2=coll.simplex2;
+  valid=true;
+}
+
 void PairCollision::glDraw(OpenGL&) {
 #ifdef RAI_GL
   arr P1=p1, P2=p2;
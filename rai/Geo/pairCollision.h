@@ -10,6 +10,8 @@
 
 #include "mesh.h"
 
+struct PairCollisionCache;
+
 struct PairCollision : GLDrawer, NonCopyable {
   //INPUTS
   const rai::Mesh* mesh1=0;
@@ -17,6 +19,9 @@ struct PairCollision : GLDrawer, NonCopyable {
   const rai::Transformation* t1=0;
   const rai::Transformation* t2=0;
   double rad1=0., rad2=0.; ///< only kinVector and glDraw account for this; the basic collision geometry (OUTPUTS below) is computed neglecting radii!!
+  PairCollisionCache* cache=0; ///< optional: state of the previous query of the same pair (warm start & reuse)
+  bool distanceBound=false;     ///< optional: the caller only needs the distance, and a lower bound when distant: such queries may be resolved on the coarse levels
+  static double lodDistance;   ///< if the meshes have a coarse level (Mesh::lod), distanceBound pairs whose conservative coarse distance exceeds this are resolved on the coarse level (distance is a lower bound, p1/p2 lie on the inflated coarse hulls)
 
   //OUTPUTS
   double distance=0.; ///< negative=penetration
@@ -31,7 +36,7 @@ struct PairCollision : GLDrawer, NonCopyable {
 
   PairCollision(rai::Mesh& mesh1, rai::Mesh& mesh2,
                 const rai::Transformation& t1, const rai::Transformation& t2,
-                double rad1=0., double rad2=0.);
+                double rad1=0., double rad2=0., PairCollisionCache* cache=0, bool distanceBound=false);
   PairCollision(ScalarFunction func1, ScalarFunction func2, const arr& seed);
   ~PairCollision() {}
 
@@ -66,11 +71,71 @@ struct PairCollision : GLDrawer, NonCopyable {
  private:
   //wrappers of external libs
   enum CCDmethod { _ccdGJKIntersect,  _ccdGJKSeparate, _ccdGJKPenetration, _ccdMPRIntersect, _ccdMPRPenetration };
-  void libccd(rai::Mesh& m1, rai::Mesh& m2, CCDmethod method); //calls ccdMPRPenetration of libccd
+  void libccd(const rai::Mesh& m1, const rai::Mesh& m2, const rai::Transformation& t1, const rai::Transformation& t2, CCDmethod method); //calls ccdMPRPenetration of libccd (on the untransformed meshes)
+  bool libccdIntersect(const rai::Mesh& m1, const rai::Mesh& m2, const rai::Transformation& t1, const rai::Transformation& t2); //only ccdGJKIntersect: no member is changed
   void GJK_sqrDistance(); //gjk_distance of libGJK
+  bool coarseDistance(); //GJK on the coarse levels (Mesh::lod); true if that resolves the query
+  bool primitiveDistance(); //closed form for point, segment and box cores (sphere, capsule, (ss)box shapes); false if the pair needs GJK
   bool simplexType(uint i, uint j) { return simplex1.d0==i && simplex2.d0==j; } //helper
 };
 
+/// adds the coarse level Mesh::lod to a mesh: its support vertices in 26 directions (cube faces, edges, corners) and the
+/// margin by which their hull needs to be inflated to contain the mesh; meshes with few vertices get no coarse level
+void makeLOD(rai::Mesh& mesh);
+
+//===========================================================================
+
+/// temporal coherence for repeated queries of the same mesh pair (e.g., one pair in one time slice across optimizer iterations):
+/// keeps the GJK simplex and support vertices to warm-start the next query, and the last result, which is reused
+/// (moved rigidly along) when the relative pose of the two meshes is unchanged
+struct PairCollisionCache {
+  const rai::Mesh *mesh1=0, *mesh2=0;     ///< the pair this cache refers to (a different pair invalidates it)
+  uint rev1=0, rev2=0;                    ///< mesh revisions when cached (a changed mesh invalidates it, see Mesh::touchV)
+  const double *Vp1=0, *Vp2=0;            ///< ..and vertex buffers/counts, which also catch direct writes of V that reallocate it
+  uint V1=0, V2=0;
+  rai::Transformation t1=0, t2=0, rel=0;  ///< poses of the last query, and t2 relative to t1
+  bool valid=false;
+
+  //-- result of the last query
+  double distance=0.;
+  arr p1, p2, normal, simplex1, simplex2;
+
+  //-- warm start
+  shared_ptr<struct simplex_point> gjk; ///< GJK's simplex (vertex indices) of the last query
+  bool gjkValid=false;
+  uint seed1=0, seed2=0;                 ///< support vertices for MPR
+
+  uint queries=0, reused=0;
+
+  void clear() { mesh1=mesh2=0; valid=gjkValid=false; }
+  bool recall(PairCollision& coll); ///< resets the cache if coll concerns a different pair; returns true (and sets coll's outputs) if the last result can be reused
+  void store(const PairCollision& coll);
+};
+
+//===========================================================================
+
+/// distances of many mesh pairs at once (e.g. all proxies of a configuration): a self-contained GJK with fixed-size
+/// stack storage (no heap arrays, no libGJK globals), so that pairs are evaluated in parallel (OPENMP) into flat outputs.
+/// Overlapping pairs are only flagged: their penetration depth needs a PairCollision
+struct PairCollisionBatch {
+  //INPUTS (add)
+  rai::Array<const rai::Mesh*> meshes1, meshes2;
+  rai::Array<const rai::Transformation*> poses1, poses2;
+  arr rad1, rad2;
+
+  //OUTPUTS (compute)
+  arr distance;   ///< n: distance of the sphere-swept meshes (i.e. minus radii); for overlapping meshes -rad1-rad2
+  arr p1, p2;     ///< n x 3: witness points on the (sphere-swept) meshes
+  arr normal;     ///< n x 3: from obj2 to obj1 (zero for overlapping pairs)
+  boolA overlap;  ///< n: whether the meshes (without radii) overlap
+
+  void clear();
+  uint add(const rai::Mesh& mesh1, const rai::Mesh& mesh2, const rai::Transformation& X1, const rai::Transformation& X2, double r1=0., double r2=0.); ///< returns the index of the pair
+  void compute();
+};
+
+//===========================================================================
+
 //return normals and closes points for 1-on-3 simplices or 2-on-2 simplices
 double coll_1on2(arr& p2, arr& normal, double& s, const arr& pts1, const arr& pts2);
 double coll_1on3(arr& p2, arr& normal, const arr& pts1, const arr& pts2);
@@ -18,6 +18,7 @@
 #include "../Kin/proxy.h"
 #include "../Kin/forceExchange.h"
 #include "../Kin/kin_swift.h"
+#include "../Kin/kin_broadphase.h"
 #include "../Kin/kin_physx.h"
 #include "../Kin/F_qFeatures.h"
 #include "../Kin/TM_default.h"
@@ -88,10 +89,12 @@ KOMO::~KOMO() {
 }
 
 void KOMO::setModel(const Configuration& C, bool _computeCollisions) {
+  rai::MemoryTagScope memTag(rai::MT_KOMO);
   orgJointIndices = C.getJointIDs();
   if(&C!=&world) world.copy(C, _computeCollisions);
   computeCollisions = _computeCollisions;
-  if(computeCollisions) {
+  if(opt.collisionLODs) makeCollisionLODs(world.frames); //the meshes are shared with the time slices
+  if(computeCollisions && !opt.sliceBroadphase) {
 #ifndef FCLmode
     world.swift();
 #else
@@ -183,6 +186,7 @@ ptr<Objective> KOMO::addObjective(const arr& times,
     if(o->feat->frameIDs.nd==2){
       o->frames.reshape(timeSlices.d1, o->feat->frameIDs.d0, o->feat->frameIDs.d1);
     }
+    setupSDFs(*o);
   }
   return task;
 }
@@ -689,6 +693,8 @@ void KOMO::reset() {
   featureValues.clear();
   featureJacobians.clear();
   featureTypes.clear();
+  sliceX_lastQuery.clear();
+  slicePairs_lastQuery.clear();
   timeTotal=timeCollisions=timeKinematics=timeNewton=timeFeatures=0.;
 }
 
@@ -697,13 +703,22 @@ struct Conv_KOMO_SparseNonfactored : MathematicalProgram {
   KOMO& komo;
   bool sparse;
   uint dimPhi=0;
+  uintA phiIndex;       ///< row offset of each grounded objective in phi (computed with getDimPhi)
+  uintAA featureGroups; ///< objectives grouped by their (shared) feature -- a group is evaluated sequentially by one thread
+  intA Jpattern;        ///< sparsity pattern of J: (row,col) tuple of each non-zero, as recorded on the last full (symbolic) assembly
+  uintA Jindex;         ///< memory offset of each objective's non-zeros within J (Jindex.last() is the total number of non-zeros)
+  byteA Jformat;        ///< format of each objective's Jacobian on the last full assembly (0: sparse, 1: dense, 2: row-shifted)
+  uintA Jsource;        ///< for each non-zero of J: its index in the objective's Jy.p (this selects the non-zeros of dense and row-shifted Jy)
 
   arr quadraticPotentialLinear, quadraticPotentialHessian;
 
   Conv_KOMO_SparseNonfactored(KOMO& _komo, bool sparse=true) : komo(_komo), sparse(sparse) {}
-  void clear() { dimPhi=0; }
+  void clear() { dimPhi=0; phiIndex.clear(); featureGroups.clear(); Jpattern.clear(); Jindex.clear(); Jformat.clear(); Jsource.clear(); }
 
   void getDimPhi();
+  void evaluateParallel(arrA& ys, arrA& Jys);
+  bool matchesJacobianPattern(uint i, const arr& Jy);
+  static byte jacobianFormat(const arr& Jy) { return isSparseMatrix(Jy) ? 0 : (isRowShifted(Jy) ? 2 : 1); }
 
   virtual uint getDimension() { return komo.pathConfig.getJointStateDimension(); }
   virtual void getFeatureTypes(ObjectiveTypeA& ft);
@@ -829,6 +844,7 @@ void KOMO::run_prepare(double addInitializationNoise) {
 }
 
 void KOMO::run(OptOptions options) {
+  rai::MemoryTagScope memTag(rai::MT_KOMO);
   Configuration::setJointStateCount=0;
   if(opt.verbose>0) {
     cout <<"** KOMO::run solver:"
@@ -1083,6 +1099,7 @@ void KOMO::retrospectApplySwitches() {
     }
   }
   switchesWereApplied=true;
+  broadphase.reset(); //its static geometry depends on the switches
 }
 
 void KOMO::retrospectChangeJointType(int startStep, int endStep, uint frameID, JointType newJointType) {
@@ -1092,6 +1109,7 @@ void KOMO::retrospectChangeJointType(int startStep, int endStep, uint frameID, J
     rai::Frame* f = timeSlices(s, frameID);
     f->setJoint(newJointType);
   }
+  broadphase.reset();
 }
 
 void KOMO::selectJointsBySubtrees(const StringA& roots, const arr& times, bool notThose){
@@ -1111,6 +1129,29 @@ void KOMO::selectJointsBySubtrees(const StringA& roots, const arr& times, bool n
   pathConfig.selectJointsBySubtrees(allRoots, notThose);
   pathConfig.ensure_q();
   pathConfig.checkConsistency();
+  broadphase.reset();
+}
+
+void KOMO::setupSDFs(GroundedObjective& ob) {
+  F_PairSDF* feat = dynamic_cast<F_PairSDF*>(ob.feat.get());
+  if(!feat) return;
+  for(uint i=1; i<ob.frames.N; i+=2) { //F(1) of each (pair of) frames
+    rai::Frame* f = ob.frames.elem(i);
+    if(!f->shape || f->shape->_sdf) continue;
+    if(f->ID<timeSlices.N && world.frames(f->ID%timeSlices.d1)->shape) {
+      rai::Shape* w = world.frames(f->ID%timeSlices.d1)->shape;
+      w->sdf(feat->resolution, feat->band);
+      f->shape->_sdf = w->_sdf;
+    } else { //frame added by a switch
+      f->shape->sdf(feat->resolution, feat->band);
+    }
+  }
+}
+
+void KOMO::setupSliceBroadphase() {
+  broadphase = make_shared<SliceBroadphaseInterface>(timeSlices, k_order);
+  broadphase->deactivate(world.getCollisionExcludeIDs());
+  broadphase->deactivatePairs(world.getCollisionExcludePairIDs());
 }
 
 
@@ -1121,6 +1162,7 @@ void KOMO::setupPathConfig() {
   //Therefore configurations(0) is for time=-k and configurations(k+t) is for time=t
   CHECK(timeSlices.d0 != k_order+T, "why setup again?");
   CHECK(!pathConfig.frames.N, "why setup again?");
+  rai::MemoryTagScope memTag(rai::MT_KOMO);
 
   //computeMeshNormals(world.frames, true);
   //computeMeshGraphs(world.frames, true);
@@ -1129,7 +1171,7 @@ void KOMO::setupPathConfig() {
   C.copy(world, true);
   C.setTaus(tau);
 
-  if(computeCollisions) {
+  if(computeCollisions && !opt.sliceBroadphase) {
     CHECK(!fcl, "");
     CHECK(!swift, "");
 #ifndef FCLmode
@@ -1150,6 +1192,8 @@ void KOMO::setupPathConfig() {
 
   }
   timeSlices = pathConfig.frames;
+  sliceX_lastQuery.clear();
+  slicePairs_lastQuery.clear();
 
   //deactivate prefix dofs
   pathConfig.calc_indexedActiveJoints();
@@ -1214,23 +1258,46 @@ void KOMO::set_x(const arr& x, const uintA& selectedConfigurationsOnly) {
     pathConfig.setJointState(x, timeSlices.sub(selectedConfigurationsOnly+k_order));
     HALT("this is untested...");
   }
+  pathConfig.calc_X_batch();
 
   timeKinematics += rai::cpuTime();
 
   if(computeCollisions) {
     timeCollisions -= rai::cpuTime();
     pathConfig.proxies.clear();
+    if(opt.sliceBroadphase) {
+      if(!broadphase) setupSliceBroadphase(); //only now: after switches were applied and dofs selected
+      //one query for all slices: static geometry is shared, the per-slice trees are updated incrementally
+      pathConfig.addProxies(broadphase->step(timeSlices, k_order));
+      pathConfig._state_proxies_isGood=true;
+      timeCollisions += rai::cpuTime();
+      return;
+    }
+    bool reuse = opt.sliceCollisionTolerance>=0.;
+    if(reuse && sliceX_lastQuery.N!=timeSlices.d0){
+      sliceX_lastQuery.clear().resize(timeSlices.d0);
+      slicePairs_lastQuery.clear().resize(timeSlices.d0);
+    }
     arr X;
     uintA collisionPairs;
     for(uint s=k_order;s<timeSlices.d0;s++){
       X = pathConfig.getFrameState(timeSlices[s]);
+      if(reuse && sliceX_lastQuery(s).N==X.N && maxDiff(X, sliceX_lastQuery(s))<=opt.sliceCollisionTolerance){
+        //the slice did not move (beyond tolerance) since its last query -> the broadphase result is still valid
+        collisionPairs = slicePairs_lastQuery(s);
+      }else{
 #ifndef FCLmode
-      collisionPairs = swift->step(X);
+        collisionPairs = swift->step(X);
 #else
-      fcl->step(X);
-      collisionPairs = fcl->collisions;
+        fcl->step(X);
+        collisionPairs = fcl->collisions;
 #endif
-      collisionPairs += timeSlices.d1 * s; //fcl returns frame IDs related to 'world' -> map them into frameIDs within that time slice
+        collisionPairs += timeSlices.d1 * s; //fcl returns frame IDs related to 'world' -> map them into frameIDs within that time slice
+        if(reuse){
+          sliceX_lastQuery(s) = X;
+          slicePairs_lastQuery(s) = collisionPairs;
+        }
+      }
       pathConfig.addProxies(collisionPairs);
     }
     pathConfig._state_proxies_isGood=true;
@@ -1471,24 +1538,52 @@ void Conv_KOMO_SparseNonfactored::evaluate(arr& phi, arr& J, const arr& x) {
 
   if(!dimPhi) getDimPhi();
 
+  komo.sos=komo.ineq=komo.eq=0.;
+
+  komo.timeFeatures -= rai::cpuTime();
+
+  //-- query all task maps (into per-objective buffers)
+  arrA ys(komo.objs.N), Jys(komo.objs.N);
+  if(komo.opt.parallelFeatures){
+    evaluateParallel(ys, Jys);
+  }else{
+    rai::ArenaScope arena(komo.opt.arenaFeatures);
+    for(uint i=0; i<komo.objs.N; i++) komo.objs(i)->feat->eval(ys(i), Jys(i), komo.objs(i)->frames);
+  }
+
+  //-- if all objective Jacobians have the recorded sparsity pattern, only their values are copied into fixed slots of J
+  bool reusePattern = !!J && sparse && Jindex.N==komo.objs.N+1;
+  for(uint i=0; reusePattern && i<komo.objs.N; i++) reusePattern = matchesJacobianPattern(i, Jys(i));
+
   phi.resize(dimPhi);
   if(!!J) {
-    if(sparse) {
+    if(reusePattern) {
+      //J still holds the pattern from the last assembly (and its row/col index) -- unless the caller changed it in between
+      rai::SparseMatrix& S = J.sparse();
+      if(J.d0!=dimPhi || J.d1!=x.N || S.elems.N!=Jpattern.N || memcmp(S.elems.p, Jpattern.p, Jpattern.N*Jpattern.sizeT)) {
+        S.reshape(dimPhi, x.N);
+        J.resizeMEM(Jindex.last(), false);
+        S.elems = Jpattern;
+        if(S.rows.nd){ S.rows.clear(); S.cols.clear(); }
+      }
+    } else if(sparse) {
       J.sparse().resize(dimPhi, x.N, 0);
+      Jindex.resize(komo.objs.N+1);
+      Jformat.resize(komo.objs.N);
+      Jsource.clear();
     } else {
       J.resize(dimPhi, x.N).setZero();
     }
   }
 
-  komo.sos=komo.ineq=komo.eq=0.;
-
-  komo.timeFeatures -= rai::cpuTime();
-
+  //-- check dimensionalities of returns and assemble phi and J
   uint M=0;
-  for(ptr<GroundedObjective>& ob : komo.objs) {
-      arr y, Jy;
-      //query the task map and check dimensionalities of returns
-      ob->feat->eval(y, Jy, ob->frames);
+  for(uint i=0; i<komo.objs.N; i++) {
+      ptr<GroundedObjective>& ob = komo.objs(i);
+      arr& y = ys(i);
+      arr& Jy = Jys(i);
+      CHECK_EQ(M, phiIndex(i), "");
+      if(!!J && sparse && !reusePattern) { Jindex(i) = J.N;  Jformat(i) = jacobianFormat(Jy); }
 //      cout <<"EVAL '" <<ob->name() <<"' phi:" <<y <<endl <<Jy <<endl<<endl;
       if(!!J) CHECK_EQ(y.N, Jy.d0, "");
       if(!y.N) continue;
@@ -1510,10 +1605,33 @@ void Conv_KOMO_SparseNonfactored::evaluate(arr& phi, arr& J, const arr& x) {
       else if(ob->type==OT_eq) komo.eq += sumOfAbs(y);
 
       if(!!J) {
-        if(sparse){
-          Jy.sparse().reshape(J.d0, J.d1);
-          Jy.sparse().colShift(M);
-          J += Jy;
+        if(reusePattern){
+          if(isSparseMatrix(Jy)) {
+            memmove(J.p+Jindex(i), Jy.p, Jy.sizeT*Jy.N);
+          } else { //gather the values of the recorded non-zeros
+            double* v = J.p+Jindex(i);
+            for(uint k=Jindex(i); k<Jindex(i+1); k++) *(v++) = Jy.p[Jsource.p[k]];
+          }
+        }else if(sparse){
+          if(isSparseMatrix(Jy)) {
+            Jy.sparse().reshape(J.d0, J.d1);
+            Jy.sparse().colShift(M);
+            J += Jy;
+            for(uint k=0; k<Jy.N; k++) Jsource.append(k);
+          } else { //only the non-zeros of dense and row-shifted blocks (a dense path-wide row must not densify J^T J)
+            rai::SparseMatrix& S = J.sparse();
+            bool rowShifted = isRowShifted(Jy);
+            uint rowSize = rowShifted ? Jy.rowShifted().rowSize : Jy.d1;
+            for(uint r=0; r<Jy.d0; r++) {
+              uint shift = rowShifted ? Jy.rowShifted().rowShift.p[r] : 0;
+              for(uint j=0; j<rowSize && shift+j<Jy.d1; j++) {
+                double v = Jy.p[r*rowSize+j];
+                if(!v) continue;
+                S.addEntry(M+r, shift+j) = v;
+                Jsource.append(r*rowSize+j);
+              }
+            }
+          }
         }else{
           J.setMatrixBlock(Jy, M, 0);
         }
@@ -1523,6 +1641,12 @@ void Conv_KOMO_SparseNonfactored::evaluate(arr& phi, arr& J, const arr& x) {
       M += y.N;
   }
 
+  //-- record the sparsity pattern of this (full) assembly
+  if(!!J && sparse && !reusePattern) {
+    Jindex.last() = J.N;
+    Jpattern = J.sparse().elems;
+  }
+
   komo.timeFeatures += rai::cpuTime();
 
   CHECK_EQ(M, dimPhi, "");
@@ -1537,6 +1661,64 @@ void Conv_KOMO_SparseNonfactored::evaluate(arr& phi, arr& J, const arr& x) {
   }
 }
 
+void Conv_KOMO_SparseNonfactored::evaluateParallel(arrA& ys, arrA& Jys) {
+  rai::Configuration& C = komo.pathConfig;
+
+  //-- some of the pathConfig's state is lazily evaluated: ensure it before going parallel (collision queries are reentrant:
+  //libGJK's working storage is thread-local, and getCollisionMesh does not create meshes)
+  C.ensure_q();
+  C.calc_X_batch();
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(uint i=0; i<C.proxies.N; i++) C.proxies(i).ensure_coll();
+
+  //-- evaluate groups concurrently; objectives sharing a feature are evaluated in sequence, as Feature::phi2 may modify the feature (e.g. order in finite differencing)
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for(uint g=0; g<featureGroups.N; g++) {
+    rai::ArenaScope arena(komo.opt.arenaFeatures); //per thread
+    rai::MemoryTagScope memTag(rai::MT_KOMO);
+    for(uint i:featureGroups(g)) {
+      GroundedObjective* ob = komo.objs(i).get();
+      ob->feat->eval(ys(i), Jys(i), ob->frames);
+    }
+  }
+}
+
+bool Conv_KOMO_SparseNonfactored::matchesJacobianPattern(uint i, const arr& Jy) {
+  uint n = Jindex(i+1)-Jindex(i);
+  if(!Jy.N) return !n;
+  if(jacobianFormat(Jy)!=Jformat(i)) return false;
+  const int* pattern = Jpattern.p + 2*Jindex(i);
+  int M = phiIndex(i);
+  if(isSparseMatrix(Jy)) {
+    if(Jy.N!=n) return false;
+    const int* e = Jy.sparse().elems.p;
+    for(uint k=0; k<n; k++) {
+      if(e[2*k]+M!=pattern[2*k] || e[2*k+1]!=pattern[2*k+1]) return false;
+    }
+    return true;
+  }
+  //dense and row-shifted: the recorded non-zeros must still be at their (row,col), and no non-zero may appear elsewhere
+  bool rowShifted = isRowShifted(Jy);
+  uint rowSize = rowShifted ? Jy.rowShifted().rowSize : Jy.d1;
+  const uint* src = Jsource.p + Jindex(i);
+  uint nonzeros=0;
+  for(uint k=0; k<n; k++) {
+    uint r = src[k]/rowSize, j = src[k]%rowSize;
+    if(r>=Jy.d0 || pattern[2*k]!=M+(int)r) return false;
+    if(pattern[2*k+1]!=(int)((rowShifted ? Jy.rowShifted().rowShift.p[r] : 0)+j)) return false;
+    if(Jy.p[src[k]]) nonzeros++;
+  }
+  for(uint r=0; r<Jy.d0; r++) {
+    uint shift = rowShifted ? Jy.rowShifted().rowShift.p[r] : 0;
+    for(uint j=0; j<rowSize && shift+j<Jy.d1; j++) if(Jy.p[r*rowSize+j] && !nonzeros--) return false;
+  }
+  return true;
+}
+
 void Conv_KOMO_SparseNonfactored::getFHessian(arr& H, const arr& x) {
   if(quadraticPotentialLinear.N) {
     H = quadraticPotentialHessian;
@@ -1559,8 +1741,21 @@ void Conv_KOMO_SparseNonfactored::report(std::ostream& os, int verbose) {
 
 void Conv_KOMO_SparseNonfactored::getDimPhi() {
   uint M=0;
-  for(ptr<GroundedObjective>& ob : komo.objs) {
+  phiIndex.resize(komo.objs.N);
+  std::map<Feature*, uint> groupOfFeature;
+  featureGroups.clear();
+  for(uint i=0; i<komo.objs.N; i++) {
+    ptr<GroundedObjective>& ob = komo.objs(i);
+    phiIndex(i) = M;
     M += ob->feat->dim(ob->frames);
+
+    auto it = groupOfFeature.find(ob->feat.get());
+    if(it==groupOfFeature.end()) {
+      groupOfFeature[ob->feat.get()] = featureGroups.N;
+      featureGroups.append(uintA{i});
+    } else {
+      featureGroups(it->second).append(i);
+    }
   }
   dimPhi = M;
 }
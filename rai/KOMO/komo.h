@@ -38,6 +38,11 @@ namespace rai {
     RAI_PARAM("KOMO/", int, verbose, 1)
     RAI_PARAM("KOMO/", int, animateOptimization, 0)
     RAI_PARAM("KOMO/", bool, mimicStable, false)
+    RAI_PARAM("KOMO/", double, sliceCollisionTolerance, 0.) //slices whose frame state changed by at most this (max diff) reuse their last collision pairs: 0 is exact; >0 is an approximation that may miss pairs that came into range; <0 disables
+    RAI_PARAM("KOMO/", bool, parallelFeatures, false) //evaluate grounded objectives concurrently (requires compiling with OPENMP)
+    RAI_PARAM("KOMO/", bool, sliceBroadphase, false) //collision pairs of all time slices from one native broadphase (static geometry shared, per-slice incremental trees) instead of swift/fcl per slice
+    RAI_PARAM("KOMO/", bool, collisionLODs, false) //coarse levels (Mesh::lod, makeCollisionLODs) for the collision meshes: distant pairs of distance queries (proxies, FS_distance) are resolved on them (PairCollision::lodDistance)
+    RAI_PARAM("KOMO/", bool, arenaFeatures, false) //feature evaluation draws its array temporaries from a thread-local scratch arena (rai::ArenaScope) instead of malloc
   };
 }//namespace
 
@@ -60,6 +65,9 @@ struct KOMO : NonCopyable {
   bool computeCollisions;         ///< whether swift or fcl (collisions/proxies) is evaluated whenever new configurations are set (needed if features read proxy list)
   shared_ptr<rai::FclInterface> fcl;
   shared_ptr<SwiftInterface> swift;
+  shared_ptr<SliceBroadphaseInterface> broadphase; ///< (if opt.sliceBroadphase) replaces swift/fcl; built on the first query, reset whenever switches or dof selections change
+  arrA sliceX_lastQuery;          ///< frame state of each time slice at its last collision query (to detect which slices need to be re-queried)
+  uintAA slicePairs_lastQuery;    ///< collision pairs of each time slice returned by its last collision query
   bool switchesWereApplied = false; //TODO: apply them directly? Would only work when no frames were added?
 
   //-- optimizer
@@ -234,6 +242,8 @@ public:
   void checkBounds(const arr& x);
   void retrospectApplySwitches();
   void retrospectChangeJointType(int startStep, int endStep, uint frameID, rai::JointType newJointType);
+  void setupSliceBroadphase();
+  void setupSDFs(GroundedObjective& ob); ///< the SDF grids of an F_PairSDF objective: built once when grounded, on the world shape, and shared by the slices (before any, possibly parallel, evaluation)
   void set_x(const arr& x, const uintA& selectedConfigurationsOnly=NoUintA);            ///< set the state trajectory of all configurations
 
 
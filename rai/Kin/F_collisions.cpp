@@ -11,11 +11,25 @@
 #include "forceExchange.h"
 
 #include "../Geo/pairCollision.h"
+#include "../Geo/analyticShapes.h"
 #include "../Optim/newton.h"
 #include "../Gui/opengl.h"
 
 //===========================================================================
 
+PairCollisionCache* PairCollisionCaches::get(rai::Frame* f1, rai::Frame* f2) {
+  if(C!=&f1->C || framesN!=f1->C.frames.N || caches.size()>=maxSize) {
+    caches.clear();
+    C=&f1->C;
+    framesN=C->frames.N;
+  }
+  shared_ptr<PairCollisionCache>& cache = caches[{f1->ID, f2->ID}];
+  if(!cache) cache = make_shared<PairCollisionCache>();
+  return cache.get();
+}
+
+//===========================================================================
+
 uint F_PairCollision::dim_phi2(const FrameL& F){
   if(type==_negScalar){
     if(F.nd==3){ CHECK_EQ(F.d0, 1, ""); return F.d1; }
@@ -34,7 +48,7 @@ void F_PairCollision::phi2(arr& y, arr& J, const FrameL& F) {
     F.last()->C.kinematicsZero(y, J, dim_phi2(_F));
     arr ysub, Jsub;
     for(uint i=0;i<_F.d0;i++){
-      F_PairCollision(type).phi2(ysub, Jsub, _F[i]);
+      phi2(ysub, Jsub, _F[i]);
       y.setVectorBlock(ysub, i);
       if(!!J) J.setMatrixBlock(Jsub, i, 0);
     }
@@ -43,20 +57,10 @@ void F_PairCollision::phi2(arr& y, arr& J, const FrameL& F) {
   CHECK_EQ(F.N, 2, "");
   rai::Frame* f1 = F.elem(0);
   rai::Frame* f2 = F.elem(1);
-  double r1=0., r2=0.;
-  rai::Mesh dot;
-  dot.setDot();
-  rai::Mesh *m1=&dot, *m2=&dot;
-  if(f1->shape && f1->shape->type()!=rai::ST_marker){
-    r1=f1->shape->radius();
-    m1 = &f1->shape->sscCore();  if(!m1->V.N) { m1 = &f1->shape->mesh(); r1=0.; }
-    if(!m1->V.N) m1 = &dot;
-  }
-  if(f2->shape && f2->shape->type()!=rai::ST_marker){
-    r2=f2->shape->radius();
-    m2 = &f2->shape->sscCore();  if(!m2->V.N) { m2 = &f2->shape->mesh(); r2=0.; }
-    if(!m2->V.N) m2 = &dot;
-  }
+  double r1, r2;
+  rai::Mesh *m1=&getCollisionMesh(r1, f1), *m2=&getCollisionMesh(r2, f2);
+
+  PairCollisionCache* cache = caches.get(f1, f2);
 
   coll.reset();
 #if 0 //use functionals!
@@ -68,7 +72,7 @@ void F_PairCollision::phi2(arr& y, arr& J, const FrameL& F) {
     coll=make_shared<PairCollision>(*m1, *m2, f1->ensure_X(), f2->ensure_X(), r1, r2);
   }
 #else
-  coll=make_shared<PairCollision>(*m1, *m2, f1->ensure_X(), f2->ensure_X(), r1, r2);
+  coll=make_shared<PairCollision>(*m1, *m2, f1->ensure_X(), f2->ensure_X(), r1, r2, cache, type==_negScalar); //only the distance may be a coarse bound: the other types need exact witness points
 #endif
 
   if(neglectRadii) coll->rad1=coll->rad2=0.;
@@ -104,13 +108,32 @@ void F_PairCollision::phi2(arr& y, arr& J, const FrameL& F) {
 void F_AccumulatedCollisions::phi2(arr& y, arr& J, const FrameL& F) {
   rai::Configuration& C = F.first()->C;
   C.kinematicsZero(y, J, 1);
-  for(rai::Proxy& p: C.proxies) {
+
+  //-- batched distances of the candidate proxies: only those within the margin need a full PairCollision
+  PairCollisionBatch batch;
+  intA batchIndex(C.proxies.N);
+  for(uint i=0; i<C.proxies.N; i++) {
+    rai::Proxy& p = C.proxies(i);
+    batchIndex(i) = -1;
+    if(p.collision || p.a->ID<F.first()->ID || p.a->ID>F.last()->ID) continue;
+    CHECK(p.a->shape, "");
+    CHECK(p.b->shape, "");
+    if(p.d > p.a->shape->radius() + p.b->shape->radius() + .01 + margin) continue;
+    double r1, r2;
+    rai::Mesh &m1=getCollisionMesh(r1, p.a), &m2=getCollisionMesh(r2, p.b);
+    batchIndex(i) = batch.add(m1, m2, p.a->ensure_X(), p.b->ensure_X(), r1, r2);
+  }
+  batch.compute();
+
+  for(uint i=0; i<C.proxies.N; i++) {
+    rai::Proxy& p = C.proxies(i);
     if(p.a->ID>=F.first()->ID && p.a->ID<=F.last()->ID) { //F.contains(p.a) && F.contains(p.b)) {
       CHECK(p.a->shape, "");
       CHECK(p.b->shape, "");
 
       //early check: if swift is way out of collision, don't bother computing it precise
       if(p.d > p.a->shape->radius() + p.b->shape->radius() + .01 + margin) continue;
+      if(batchIndex(i)>=0 && batch.distance(batchIndex(i))>margin) continue;
 
       if(!p.collision) p.calc_coll();
 
@@ -132,6 +155,134 @@ void F_AccumulatedCollisions::phi2(arr& y, arr& J, const FrameL& F) {
 
 //===========================================================================
 
+static void interpolate(rai::Transformation& X, const rai::Transformation& A, const rai::Transformation& B, double s) {
+  X.pos = A.pos + s*(B.pos-A.pos);
+  X.rot.setInterpolate(s, A.rot, B.rot);
+}
+
+//upper bound on the speed (per unit s) of any point of the mesh (plus radius r) when interpolating from A to B: the translation
+//is linear, but the rotation is an nlerp (Quaternion::setInterpolate), whose rate is not uniform -- it peaks at s=.5 with
+//4 tan(angle/4) (the slerp rate 'angle' would underestimate it)
+static double motionBound(const rai::Transformation& A, const rai::Transformation& B, const rai::Mesh& m, double r) {
+  double angle = 2.*acos(rai::MIN(1., fabs(quat_scalarProduct(A.rot, B.rot))));
+  return (B.pos-A.pos).length() + 4.*tan(.25*angle)*(m.getRadius()+r);
+}
+
+void F_PairCollisionSwept::phi2(arr& y, arr& J, const FrameL& F) {
+  CHECK_EQ(order, 1, "the swept collision is defined between two consecutive slices");
+  CHECK(F.nd==2 && F.d0==2 && F.d1==2, "need 2 x 2 frames (two slices of two frames)");
+  rai::Frame *a0=F(0, 0), *b0=F(0, 1), *a1=F(1, 0), *b1=F(1, 1);
+  double r1, r2;
+  rai::Mesh &m1=getCollisionMesh(r1, a1), &m2=getCollisionMesh(r2, b1);
+  const rai::Transformation &A0=a0->ensure_X(), &A1=a1->ensure_X(), &B0=b0->ensure_X(), &B1=b1->ensure_X();
+
+  PairCollisionCache* cache = caches.get(a1, b1);
+
+  //-- conservative advancement: no pair of points can close the gap d faster than 'bound' per unit s
+  double bound = motionBound(A0, A1, m1, r1) + motionBound(B0, B1, m2, r2);
+  rai::Transformation As, Bs, Abest, Bbest;
+  double t=0.;
+  coll.reset();
+  for(uint k=0;; k++) {
+    interpolate(As, A0, A1, t);
+    interpolate(Bs, B0, B1, t);
+    auto c = make_shared<PairCollision>(m1, m2, As, Bs, r1, r2, cache);
+    if(!coll || c->getDistance()<coll->getDistance()) { coll=c;  s=t;  Abest=As;  Bbest=Bs; }
+    double d = c->getDistance();
+    if(d<tolerance || t>=1. || k>=maxIters || bound<1e-10) break;
+    t += d/bound;
+    if(t>1.) t=1.;
+  }
+
+  //-- the witness points move with their frames; their slice t-1 and t positions are interpolated with s
+  y.resize(1).scalar() = -coll->getDistance();
+  if(!!J) {
+    rai::Vector v1 = Abest / rai::Vector(coll->p1), v2 = Bbest / rai::Vector(coll->p2);
+    arr Ja0, Ja1, Jb0, Jb1;
+    a0->C.jacobian_pos(Ja0, a0, A0*v1);
+    a1->C.jacobian_pos(Ja1, a1, A1*v1);
+    b0->C.jacobian_pos(Jb0, b0, B0*v2);
+    b1->C.jacobian_pos(Jb1, b1, B1*v2);
+    arr Jdiff = (1.-s)*(Ja0-Jb0) + s*(Ja1-Jb1);
+    J = ~coll->normal*Jdiff;
+    J *= -1.;
+    checkNan(J);
+  }
+}
+
+//===========================================================================
+
+void F_PairSDF::phi2(arr& y, arr& J, const FrameL& F) {
+  if(order>0){  Feature::phi2(y, J, F);  return;  }
+  CHECK_EQ(F.N, 2, "");
+  rai::Frame* f1 = F.elem(0);
+  rai::Frame* f2 = F.elem(1);
+  CHECK(f1->shape && f2->shape, "");
+  double r1;
+  rai::Mesh* m1 = &getCollisionMesh(r1, f1);
+  const DistanceFunction_Grid& sdf = f2->shape->sdf(resolution, band);
+
+  //-- the point of m1 deepest in the SDF: not only its vertices, also its edges and faces, sampled at the grid
+  //   resolution (a thin wall can pass between the vertices of a core)
+  rai::Transformation rel = f1->ensure_X() / f2->ensure_X();
+  double R[9], xBest[3], vBest[3];
+  rel.rot.getMatrix(R);
+  const double *p=&rel.pos.x;
+  double d=std::numeric_limits<double>::infinity();
+  auto probe = [&](const double* v) {
+    double x[3];
+    for(uint k=0; k<3; k++) x[k] = p[k] + R[3*k]*v[0] + R[3*k+1]*v[1] + R[3*k+2]*v[2];
+    double di = sdf.lookup(0, x);
+    if(di<d) { d=di;  memmove(xBest, x, 3*sizeof(double));  memmove(vBest, v, 3*sizeof(double)); }
+  };
+  auto dist = [](const double* a, const double* b) { return sqrt(rai::sqr(a[0]-b[0]) + rai::sqr(a[1]-b[1]) + rai::sqr(a[2]-b[2])); };
+  const arr& V = m1->V;
+  double v[3];
+  if(m1->T.N) { //barycentric grid on each triangle, including its edges and corners
+    for(uint t=0; t<m1->T.d0; t++) {
+      const double *a=&V(m1->T(t, 0), 0), *b=&V(m1->T(t, 1), 0), *c=&V(m1->T(t, 2), 0);
+      double l = rai::MAX(rai::MAX(dist(a, b), dist(b, c)), dist(c, a));
+      uint n = rai::MAX(1u, uint(ceil(l/sdf.res)));
+      for(uint i=0; i<=n; i++) for(uint j=0; i+j<=n; j++) {
+        double wb=double(i)/n, wc=double(j)/n;
+        for(uint k=0; k<3; k++) v[k] = a[k] + wb*(b[k]-a[k]) + wc*(c[k]-a[k]);
+        probe(v);
+      }
+    }
+  } else { //no triangles (e.g. capsule core): the vertices and the segments between them
+    for(uint i=0; i<V.d0; i++) {
+      probe(&V(i, 0));
+      for(uint j=i+1; j<V.d0; j++) {
+        const double *a=&V(i, 0), *b=&V(j, 0);
+        uint n = uint(ceil(dist(a, b)/sdf.res));
+        for(uint s=1; s<n; s++) {
+          double w=double(s)/n;
+          for(uint k=0; k<3; k++) v[k] = a[k] + w*(b[k]-a[k]);
+          probe(v);
+        }
+      }
+    }
+  }
+
+  y.resize(1).scalar() = -(d-r1);
+  if(!!J) {
+    double g[3];
+    sdf.lookup(g, xBest);
+    rai::Vector nw = f2->ensure_X().rot * rai::Vector(g[0], g[1], g[2]);
+    rai::Vector pos = f1->ensure_X() * rai::Vector(vBest[0], vBest[1], vBest[2]);
+    arr normal = {nw.x, nw.y, nw.z};
+    arr Jp1, Jp2;
+    f1->C.jacobian_pos(Jp1, f1, pos);
+    f2->C.jacobian_pos(Jp2, f2, pos);
+    arr Jdiff = Jp1 - Jp2;
+    J = ~normal*Jdiff;
+    J *= -1.;
+    checkNan(J);
+  }
+}
+
+//===========================================================================
+
 namespace rai{
   template<class T>
 arr block(const Array<T>& A, const Array<T>& B, const Array<T>& C, const Array<T>& D){
@@ -12,6 +12,22 @@
 
 //===========================================================================
 
+/// the PairCollisionCaches of a collision feature, per frame ID pair (i.e., per pair and time slice in a path configuration);
+/// the caches are dropped when the feature is evaluated on a different or rebuilt configuration (other frame count), and when
+/// more than maxSize pairs are cached
+struct PairCollisionCaches {
+  std::map<std::pair<uint, uint>, shared_ptr<struct PairCollisionCache>> caches;
+  const rai::Configuration* C=0; ///< the configuration the caches refer to..
+  uint framesN=0;                ///< ..and its frame count
+  uint maxSize;
+
+  PairCollisionCaches(uint _maxSize=10000) : maxSize(_maxSize) {}
+  struct PairCollisionCache* get(rai::Frame* f1, rai::Frame* f2);
+  void clear() { caches.clear();  C=0;  framesN=0; }
+};
+
+//===========================================================================
+
 struct F_PairCollision : Feature {
   enum Type { _none=-1, _negScalar, _vector, _normal, _center, _p1, _p2 };
 
@@ -19,6 +35,7 @@ struct F_PairCollision : Feature {
   bool neglectRadii=false;
 
   shared_ptr<struct PairCollision> coll;
+  PairCollisionCaches caches;
 
   F_PairCollision(Type _type=_negScalar, bool _neglectRadii=false)
     : type(_type), neglectRadii(_neglectRadii) {
@@ -29,6 +46,39 @@ struct F_PairCollision : Feature {
 
 //===========================================================================
 
+/// continuous collision between two consecutive time slices (order 1, F is 2 x 2: both frames in slice t-1 and t):
+/// conservative advancement along the interpolated poses (steps that no pair of points can close the gap in) finds the first
+/// contact (closer than tolerance) of the swept shapes, which a discrete check in the slices misses for thin or fast geometry.
+/// y is the negative distance (as F_PairCollision::_negScalar) at the first contact; without contact, it is the smallest
+/// distance at the sampled times, which is positive but may overestimate the closest approach in between.
+/// J interpolates the two slices' Jacobians. In KOMO, add it for explicit pairs: FS_distanceSwept (order 1)
+struct F_PairCollisionSwept : Feature {
+  double tolerance; ///< advancement stops when closer than this
+  uint maxIters;
+
+  shared_ptr<struct PairCollision> coll; ///< (output) collision at the critical time
+  double s=0.;                           ///< (output) critical interpolation time in [0,1] between slice t-1 and t
+  PairCollisionCaches caches;
+
+  F_PairCollisionSwept(double _tolerance=1e-3, uint _maxIters=100) : tolerance(_tolerance), maxIters(_maxIters) { order=1; }
+  virtual void phi2(arr& y, arr& J, const FrameL& F);
+  virtual uint dim_phi2(const FrameL& F){ return 1; }
+};
+
+//===========================================================================
+
+/// distance of F(0)'s shape to the precomputed signed distance field (Shape::sdf) of F(1)'s shape, e.g. static environment
+/// geometry: minimum over the vertices of F(0)'s (core) mesh, minus its radius; as F_PairCollision::_negScalar, y is the negative distance
+struct F_PairSDF : Feature {
+  double resolution, band; ///< of the SDF, when it needs to be computed
+
+  F_PairSDF(double _resolution=.02, double _band=.1) : resolution(_resolution), band(_band) {}
+  virtual void phi2(arr& y, arr& J, const FrameL& F);
+  virtual uint dim_phi2(const FrameL& F){ return 1; }
+};
+
+//===========================================================================
+
 struct F_PairFunctional : Feature, GLDrawer {
   virtual void phi2(arr& y, arr& J, const FrameL& F);
   virtual uint dim_phi2(const FrameL& F){ return 1; }
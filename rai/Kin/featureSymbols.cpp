@@ -46,6 +46,8 @@ template<> const char* rai::Enum<FeatureSymbol>::names []= {
   "accumulatedCollisions",
   "jointLimits",
   "distance",
+  "distanceSDF",
+  "distanceSwept",
   "oppose",
 
   "qItself",
@@ -95,6 +97,8 @@ double shapeSize(const rai::Configuration& K, const char* name, uint i=2) {
 ptr<Feature> symbols2feature(FeatureSymbol feat, const StringA& frames, const rai::Configuration& C, const arr& scale, const arr& target, int order) {
   shared_ptr<Feature> f;
   if(feat==FS_distance) {  f=make_shared<F_PairCollision>(F_PairCollision::_negScalar, false); }
+  else if(feat==FS_distanceSDF) {  f=make_shared<F_PairSDF>(); }
+  else if(feat==FS_distanceSwept) {  f=make_shared<F_PairCollisionSwept>(); }
   else if(feat==FS_oppose) {  f=make_shared<F_GraspOppose>(); }
   else if(feat==FS_aboveBox) {  f=make_shared<F_AboveBox>(); }
   else if(feat==FS_insideBox) {  f=make_shared<F_InsideBox>(); }
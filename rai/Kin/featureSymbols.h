@@ -44,6 +44,8 @@ enum FeatureSymbol {
   FS_accumulatedCollisions,
   FS_jointLimits,
   FS_distance,
+  FS_distanceSDF,
+  FS_distanceSwept,
   FS_oppose,
 
   FS_qItself,
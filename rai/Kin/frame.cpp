@@ -78,11 +78,13 @@ rai::Frame::~Frame() {
   while(children.N) children.last()->unLink();
   if(this==C.frames.last()) { //great: this is very efficient to remove without breaking indexing
     CHECK_EQ(ID, C.frames.N-1, "");
+    C.unindexFrame(this);
     C.frames.resizeCopy(C.frames.N-1);
   }else{
     CHECK_EQ(this, C.frames.elem(ID), "");
     C.frames.remove(ID);
     listReindex(C.frames);
+    C.reset_frameIndex();
   }
   C.reset_q();
 }
@@ -96,14 +98,7 @@ void rai::Frame::calc_X_from_parent() {
   X = from;
   X.appendTransformation(Q);
   CHECK_EQ(X.pos.x, X.pos.x, "NAN transformation:" <<from <<'*' <<Q);
-  if(joint) {
-    Joint* j = joint;
-    if(j->type==JT_hingeX || j->type==JT_transX || j->type==JT_XBall)  j->axis = from.rot.getX();
-    if(j->type==JT_hingeY || j->type==JT_transY)  j->axis = from.rot.getY();
-    if(j->type==JT_hingeZ || j->type==JT_transZ)  j->axis = from.rot.getZ();
-    if(j->type==JT_transXYPhi || j->type==JT_transYPhi)  j->axis = from.rot.getZ();
-    if(j->type==JT_phiTransXY)  j->axis = from.rot.getZ();
-  }
+  if(joint) joint->calc_axis_from_parent();
 
   _state_X_isGood=true;
   C._state_proxies_isGood = false;
@@ -335,6 +330,7 @@ void rai::Frame::read(const Graph& ats) {
     }
     sh->type() = rai::ST_ssCvx;
     sh->sscCore().V = core;
+    sh->sscCore().touchV();
     sh->size = ARR(r);
     sh->mesh().C = ARR(1., 1., 0., .5);
     sh->mesh().setSSCvx(core, r);
@@ -446,6 +442,7 @@ rai::Frame& rai::Frame::setPointCloud(const arr& points, const byteA& colors) {
     return *this;
   }
   getShape().mesh().V.clear().operator=(points).reshape(-1, 3);
+  getShape().mesh().touchV();
   if(colors.N) {
     getShape().mesh().C.clear().operator=(convert<double>(byteA(colors))/255.).reshape(-1, 3);
   }
@@ -670,6 +667,19 @@ rai::Joint::~Joint() {
   if(mimic) mimic->mimicers.removeValue(this);
 }
 
+void rai::Joint::calc_axis_from_parent() {
+  calcAxis(axis, frame->parent->X.rot);
+}
+
+/// the world-frame joint axis, given the parent's world rotation (unchanged for joint types without an axis)
+void rai::Joint::calcAxis(Vector& _axis, const Quaternion& from) const {
+  if(type==JT_hingeX || type==JT_transX || type==JT_XBall)  _axis = from.getX();
+  if(type==JT_hingeY || type==JT_transY)  _axis = from.getY();
+  if(type==JT_hingeZ || type==JT_transZ)  _axis = from.getZ();
+  if(type==JT_transXYPhi || type==JT_transYPhi)  _axis = from.getZ();
+  if(type==JT_phiTransXY)  _axis = from.getZ();
+}
+
 const rai::Transformation& rai::Joint::X() const {
   return frame->parent->get_X();
 }
@@ -693,14 +703,11 @@ void rai::Joint::setMimic(rai::Joint* j, bool unsetPreviousMimic){
   }
 }
 
-void rai::Joint::setDofs(const arr& q_full, uint _qIndex) {
-  if(type==JT_rigid) return;
-  CHECK(dim!=UINT_MAX, "");
-  CHECK_LE(_qIndex+dim, q_full.N, "");
-  rai::Transformation& Q = frame->Q;
+/// the relative transformation realized by this joint for the dofs q_full[_qIndex..] (independent of mimic; no change of frame state)
+void rai::Joint::calcQ(Transformation& Q, const arr& q_full, uint _qIndex) const {
   Q.setZero();
   std::shared_ptr<arr> q_copy;
-  double* qp;
+  const double* qp;
   if(scale==1.) {
     qp = q_full.p + _qIndex;
   } else {
@@ -709,112 +716,122 @@ void rai::Joint::setDofs(const arr& q_full, uint _qIndex) {
     *q_copy *= scale;
     qp = q_copy->p;
   }
+  switch(type) {
+    case JT_hingeX: {
+      Q.rot.setRadX(qp[0]);
+    } break;
+
+    case JT_hingeY: {
+      Q.rot.setRadY(qp[0]);
+    } break;
+
+    case JT_hingeZ: {
+      Q.rot.setRadZ(qp[0]);
+    } break;
+
+    case JT_universal: {
+      rai::Quaternion rot1, rot2;
+      rot1.setRadX(qp[0]);
+      rot2.setRadY(qp[1]);
+      Q.rot = rot1*rot2;
+    } break;
+
+    case JT_quatBall: {
+      Q.rot.set(qp);
+      {
+        double n=Q.rot.normalization();
+        if(!rai_Kin_frame_ignoreQuatNormalizationWarning) if(n<.1 || n>10.) LOG(-1) <<"quat normalization is extreme: " <<n;
+      }
+      Q.rot.normalize();
+      Q.rot.isZero=false; //WHY? (gradient check fails without!)
+    } break;
+
+    case JT_free: {
+      Q.pos.set(qp);
+      Q.rot.set(qp+3);
+      {
+        double n=Q.rot.normalization();
+        if(!rai_Kin_frame_ignoreQuatNormalizationWarning) if(n<.1 || n>10.) LOG(-1) <<"quat normalization is extreme: " <<n;
+      }
+      Q.rot.normalize();
+      Q.rot.isZero=false;
+    } break;
+
+    case JT_XBall: {
+      Q.pos.x = qp[0];
+      Q.pos.y = 0.;
+      Q.pos.z = 0.;
+      Q.pos.isZero = false;
+      Q.rot.set(qp+1);
+      {
+        double n=Q.rot.normalization();
+        if(n<.1 || n>10.) LOG(-1) <<"quat normalization is extreme: " <<n;
+      }
+      Q.rot.normalize();
+      Q.rot.isZero=false;
+    } break;
+
+    case JT_transX: {
+      Q.pos = qp[0] * Vector_x;
+    } break;
+
+    case JT_transY: {
+      Q.pos = qp[0] * Vector_y;
+    } break;
+
+    case JT_transZ: {
+      Q.pos = qp[0] * Vector_z;
+    } break;
+
+    case JT_transXY: {
+      Q.pos.set(qp[0], qp[1], 0.);
+    } break;
+
+    case JT_trans3: {
+      Q.pos.set(qp);
+    } break;
+
+    case JT_transXYPhi: {
+      Q.pos.set(qp[0], qp[1], 0.);
+      Q.rot.setRadZ(qp[2]);
+    } break;
+
+    case JT_transYPhi: {
+      Q.pos.set(0., qp[0], 0.);
+      Q.rot.setRadZ(qp[1]);
+    } break;
+
+    case JT_phiTransXY: {
+      Q.rot.setRadZ(qp[0]);
+      Q.pos = Q.rot*Vector(qp[1], qp[2], 0.);
+    } break;
+
+    case JT_rigid:
+      break;
+
+    case JT_tau: //only changes frame->tau, see setDofs
+      break;
+    default: NIY;
+  }
+}
+
+void rai::Joint::setDofs(const arr& q_full, uint _qIndex) {
+  if(type==JT_rigid) return;
+  CHECK(dim!=UINT_MAX, "");
+  CHECK_LE(_qIndex+dim, q_full.N, "");
+  rai::Transformation& Q = frame->Q;
+  Q.setZero();
   if(mimic) {
     if(type!=JT_tau){
       Q = mimic->frame->get_Q();
     }else{
       frame->tau = mimic->frame->tau;
     }
+  } else if(type==JT_tau) {
+    frame->tau = 1e-1 * scale * q_full.elem(_qIndex);
+    if(frame->tau<1e-10) frame->tau=1e-10;
   } else {
-    switch(type) {
-      case JT_hingeX: {
-        Q.rot.setRadX(qp[0]);
-      } break;
-
-      case JT_hingeY: {
-        Q.rot.setRadY(qp[0]);
-      } break;
-
-      case JT_hingeZ: {
-        Q.rot.setRadZ(qp[0]);
-      } break;
-
-      case JT_universal: {
-        rai::Quaternion rot1, rot2;
-        rot1.setRadX(qp[0]);
-        rot2.setRadY(qp[1]);
-        Q.rot = rot1*rot2;
-      } break;
-
-      case JT_quatBall: {
-        Q.rot.set(qp);
-        {
-          double n=Q.rot.normalization();
-          if(!rai_Kin_frame_ignoreQuatNormalizationWarning) if(n<.1 || n>10.) LOG(-1) <<"quat normalization is extreme: " <<n;
-        }
-        Q.rot.normalize();
-        Q.rot.isZero=false; //WHY? (gradient check fails without!)
-      } break;
-
-      case JT_free: {
-        Q.pos.set(qp);
-        Q.rot.set(qp+3);
-        {
-          double n=Q.rot.normalization();
-          if(!rai_Kin_frame_ignoreQuatNormalizationWarning) if(n<.1 || n>10.) LOG(-1) <<"quat normalization is extreme: " <<n;
-        }
-        Q.rot.normalize();
-        Q.rot.isZero=false;
-      } break;
-
-      case JT_XBall: {
-        Q.pos.x = qp[0];
-        Q.pos.y = 0.;
-        Q.pos.z = 0.;
-        Q.pos.isZero = false;
-        Q.rot.set(qp+1);
-        {
-          double n=Q.rot.normalization();
-          if(n<.1 || n>10.) LOG(-1) <<"quat normalization is extreme: " <<n;
-        }
-        Q.rot.normalize();
-        Q.rot.isZero=false;
-      } break;
-
-      case JT_transX: {
-        Q.pos = qp[0] * Vector_x;
-      } break;
-
-      case JT_transY: {
-        Q.pos = qp[0] * Vector_y;
-      } break;
-
-      case JT_transZ: {
-        Q.pos = qp[0] * Vector_z;
-      } break;
-
-      case JT_transXY: {
-        Q.pos.set(qp[0], qp[1], 0.);
-      } break;
-
-      case JT_trans3: {
-        Q.pos.set(qp);
-      } break;
-
-      case JT_transXYPhi: {
-        Q.pos.set(qp[0], qp[1], 0.);
-        Q.rot.setRadZ(qp[2]);
-      } break;
-
-      case JT_transYPhi: {
-        Q.pos.set(0., qp[0], 0.);
-        Q.rot.setRadZ(qp[1]);
-      } break;
-
-      case JT_phiTransXY: {
-        Q.rot.setRadZ(qp[0]);
-        Q.pos = Q.rot*Vector(qp[1], qp[2], 0.);
-      } break;
-
-      case JT_rigid:
-        break;
-
-      case JT_tau:
-        frame->tau = 1e-1 * qp[0];
-        if(frame->tau<1e-10) frame->tau=1e-10;
-        break;
-      default: NIY;
-    }
+    calcQ(Q, q_full, _qIndex);
   }
   CHECK_EQ(Q.pos.x, Q.pos.x, "NAN transform");
   CHECK_EQ(Q.rot.w, Q.rot.w, "NAN transform");
@@ -1216,6 +1233,7 @@ rai::Shape::Shape(Frame& f, const Shape* copyShape)
     const Shape& s = *copyShape;
     if(s._mesh) _mesh = s._mesh; //shallow shared_ptr copy!
     if(s._sscCore) _sscCore = s._sscCore; //shallow shared_ptr copy!
+    if(s._sdf) _sdf = s._sdf; //shallow shared_ptr copy!
     _type = s._type;
     size = s.size;
     cont = s.cont;
@@ -1406,6 +1424,7 @@ void rai::Shape::createMeshes() {
       break;
     case rai::ST_sphere: {
       sscCore().V = arr({1, 3}, {0., 0., 0.});
+      sscCore().touchV();
       double rad=1;
       if(size.N) rad=size(-1);
       mesh().setSSCvx(sscCore().V, rad);
@@ -1417,6 +1436,7 @@ void rai::Shape::createMeshes() {
     case rai::ST_capsule:
       CHECK(size(-1)>1e-10, "");
       sscCore().V = arr({2, 3}, {0., 0., -.5*size(-2), 0., 0., .5*size(-2)});
+      sscCore().touchV();
       mesh().setSSCvx(sscCore().V, size(-1));
       break;
     case rai::ST_marker:
@@ -1506,6 +1526,21 @@ shared_ptr<ScalarFunction> rai::Shape::functional(bool worldCoordinates){
 
 }
 
+DistanceFunction_Grid& rai::Shape::sdf(double resolution, double band){
+  if(!_sdf){
+    if(!mesh().V.N) createMeshes();
+    CHECK(mesh().V.N, "shape '" <<frame.name <<"' has no geometry");
+    shared_ptr<ScalarFunction> f = functional(false);
+    if(f){
+      arr box = mesh().getBox();
+      _sdf = make_shared<DistanceFunction_Grid>(*f, box[0], box[1], resolution, band);
+    }else{
+      _sdf = make_shared<DistanceFunction_Grid>(mesh(), resolution, band);
+    }
+  }
+  return *_sdf;
+}
+
 rai::Inertia::Inertia(Frame& f, Inertia* copyInertia) : frame(f), type(BT_dynamic) {
   CHECK(!frame.inertia, "this frame ('" <<frame.name <<"') already has inertia");
   frame.inertia = this;
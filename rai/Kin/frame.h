@@ -38,6 +38,8 @@ typedef rai::Array<rai::Dof*> DofL;
 typedef rai::Array<rai::Shape*> ShapeL;
 
 extern rai::Frame& NoFrame;
+
+struct DistanceFunction_Grid;
 //extern rai::Shape& NoShape;
 //extern rai::Joint& NoJoint;
 
@@ -228,7 +230,10 @@ struct Joint : Dof, NonCopyable {
 
   void setMimic(Joint* j, bool unsetPreviousMimic=false);
   void setDofs(const arr& q, uint n=0);
+  void calcQ(Transformation& Q, const arr& q_full, uint _qIndex) const;
   arr calcDofsFromConfig() const;
+  void calc_axis_from_parent(); ///< update the world-frame axis from the parent's (current) X
+  void calcAxis(Vector& _axis, const Quaternion& from) const;
   arr getScrewMatrix();
   uint getDimFromType() const;
   arr get_h() const;
@@ -282,6 +287,7 @@ struct Shape : NonCopyable, GLDrawer {
   arr size;
   ptr<Mesh> _mesh;
   ptr<Mesh> _sscCore;
+  ptr<DistanceFunction_Grid> _sdf; ///< (optional) precomputed signed distance field, in frame coordinates
   char cont=0;           ///< are contacts registered (or filtered in the callback)
 
   double radius() { if(size.N) return size(-1); return 0.; }
@@ -292,6 +298,7 @@ struct Shape : NonCopyable, GLDrawer {
 
   void createMeshes();
   shared_ptr<ScalarFunction> functional(bool worldCoordinates=true);
+  DistanceFunction_Grid& sdf(double resolution=.02, double band=.1); ///< computed on first call (from the analytic functional, or else the mesh) -- not thread safe: KOMO precomputes it (KOMO::setupSDFs)
 
   Shape(Frame& f, const Shape* copyShape=nullptr); //new Shape, being added to graph and frame's shape lists
   virtual ~Shape();
@@ -13,6 +13,7 @@
 #include "uncertainty.h"
 #include "proxy.h"
 #include "kin_swift.h"
+#include "kin_broadphase.h"
 #include "kin_physx.h"
 #include "kin_ode.h"
 #include "kin_feather.h"
@@ -21,6 +22,7 @@
 #include "../Core/graph.h"
 #include "../Geo/fclInterface.h"
 #include "../Geo/qhull.h"
+#include "../Geo/pairCollision.h"
 #include "../Geo/mesh_readAssimp.h"
 #include "../GeoOptim/geoOptim.h"
 #include "../Gui/opengl.h"
@@ -29,6 +31,7 @@
 #include <algorithm>
 #include <sstream>
 #include <climits>
+#include <unordered_map>
 
 #ifdef RAI_ASSIMP
 #  include <assimp/Exporter.hpp>
@@ -82,6 +85,14 @@ void makeConvexHulls(FrameL& frames, bool onlyContactShapes) {
       f->shape->mesh().makeConvexHull();
 }
 
+void makeCollisionLODs(FrameL& frames) {
+  for(Frame* f: frames) if(f->shape && f->shape->cont) {
+      Mesh* m = &f->shape->sscCore();
+      if(!m->V.N) m = &f->shape->mesh();
+      if(m->V.N) makeLOD(*m);
+    }
+}
+
 void computeOptimalSSBoxes(FrameL& frames) {
   NIY;
 #if 0
@@ -125,9 +136,59 @@ struct sConfiguration {
   shared_ptr<ConfigurationViewer> viewer;
   shared_ptr<SwiftInterface> swift;
   shared_ptr<FclInterface> fcl;
+  shared_ptr<BroadphaseInterface> broadphase;
   unique_ptr<PhysXInterface> physx;
   unique_ptr<OdeInterface> ode;
   unique_ptr<FeatherstoneInterface> fs;
+
+  //-- name->frame index for getFrame: only updated by structural (non-const) operations, so that lookups are read-only;
+  //   frames appended since (e.g. by 'new Frame(C)', named afterwards) are searched linearly until the next update
+  std::unordered_map<std::string, uintA> frameIndex; ///< for each name, the IDs of all frames with that name (ascending)
+  uint frameIndex_N=0; ///< frames [0,frameIndex_N) are indexed
+
+  //-- structure-of-arrays pose buffers for calc_X_batch: frames in topological order; poses as rows (x,y,z) and (w,x,y,z) over slots
+  FrameL poseOrder;   ///< frames in topological order (parents before children)
+  uintA poseSlot;     ///< for each frame ID, its slot in poseOrder
+  intA poseParent;    ///< for each slot, the slot of the parent (-1 for roots)
+  arr posePos, poseRot;   ///< 3 x N and 4 x N absolute poses
+  arr relPos, relRot;     ///< 3 x N and 4 x N relative transforms Q
+  byteA poseFlags;    ///< per slot: 1=needs update, 2=Q.pos is zero, 4=Q.rot is zero, 8=X.rot is zero
+
+  void calc_poseOrder(const Configuration& C){
+    poseOrder = C.calc_topSort();
+    poseSlot.resize(poseOrder.N);
+    for(uint i=0; i<poseOrder.N; i++) poseSlot(poseOrder.elem(i)->ID) = i;
+    poseParent.resize(poseOrder.N);
+    for(uint i=0; i<poseOrder.N; i++) {
+      Frame* f = poseOrder.elem(i);
+      poseParent.elem(i) = f->parent ? (int)poseSlot(f->parent->ID) : -1;
+    }
+  }
+
+  bool check_poseOrder(const FrameL& frames){
+    if(poseOrder.N!=frames.N || poseSlot.N!=frames.N) return false;
+    for(Frame* f:frames) {
+      if(f->ID>=poseSlot.N) return false;
+      uint i = poseSlot.elem(f->ID);
+      if(poseOrder.elem(i)!=f) return false;
+      if(poseParent.elem(i) != (f->parent ? (int)poseSlot(f->parent->ID) : -1)) return false;
+    }
+    return true;
+  }
+
+  void calc_frameIndex(const FrameL& frames){
+    frameIndex.clear();
+    frameIndex_N = 0;
+    index_appendedFrames(frames);
+  }
+
+  void index_appendedFrames(const FrameL& frames){
+    for(uint i=frameIndex_N; i<frames.N; i++) {
+      Frame* f = frames.elem(i);
+      frameIndex[f->name.p?f->name.p:""].append(f->ID);
+    }
+    frameIndex_N = frames.N;
+  }
 };
 
 Configuration::Configuration() {
@@ -139,6 +200,7 @@ Configuration::~Configuration() {
   self->viewer.reset();
   self->swift.reset();
   self->fcl.reset();
+  self->broadphase.reset();
   clear();
   self.reset();
 }
@@ -155,6 +217,7 @@ void Configuration::copy(const Configuration& C, bool referenceSwiftOnCopy) {
   for(Frame* f:C.frames) if(f->parent) frames.elem(f->ID)->setParent(frames.elem(f->parent->ID));
 //  addFramesCopy(C.frames);
   frames.reshapeAs(C.frames);
+  self->index_appendedFrames(frames);
 
   //copy proxies; first they point to origin frames; afterwards, let them point to own frames
   copyProxies(C.proxies);
@@ -170,6 +233,7 @@ void Configuration::copy(const Configuration& C, bool referenceSwiftOnCopy) {
   if(referenceSwiftOnCopy) {
     self->swift = C.self->swift;
     self->fcl = C.self->fcl;
+    self->broadphase = C.self->broadphase;
   }
 
   //copy vector state
@@ -184,6 +248,7 @@ bool Configuration::operator!() const { return this==&NoConfiguration; }
 Frame* Configuration::addFrame(const char* name, const char* parent, const char* args) {
   Frame* f = new Frame(*this);
   f->name = name;
+  self->index_appendedFrames(frames);
 
   if(parent && parent[0]) {
     Frame* p = getFrame(parent);
@@ -269,10 +334,12 @@ Frame* Configuration::addObject(ShapeType shape, const arr& size, const arr& col
     if(shape==ST_mesh) {
       s->mesh().V = size;
       s->mesh().V.reshape(-1, 3);
+      s->mesh().touchV();
     }
     if(shape==ST_ssCvx) {
       s->sscCore().V = size;
       s->sscCore().V.reshape(-1, 3);
+      s->sscCore().touchV();
       CHECK(radius>0., "radius must be greater zero");
       s->size() = ARR(radius);
     }
@@ -340,6 +407,7 @@ Frame* Configuration::addCopies(const FrameL& F, const ForceExchangeL& _forces)
   }
 
   if(!(frames.N%F.N)) frames.reshape(-1, F.N);
+  self->index_appendedFrames(frames);
 
   return frames.elem(FId2thisId(F.first()->ID));
 }
@@ -352,10 +420,22 @@ void Configuration::addConfiguration(const Configuration& C, double tau){
 
 /// get first frame with given name
 Frame* Configuration::getFrame(const char* name, bool warnIfNotExist, bool reverse) const {
+  //-- lookup in the index (read-only), and a linear search through the frames appended since its last update
+  uint nIndexed = self->frameIndex_N;
+  CHECK_LE(nIndexed, frames.N, "the frame index is out of date");
+  if(reverse) {
+    for(uint i=frames.N; i-->nIndexed;) if(frames.elem(i)->name==name) return frames.elem(i);
+  }
+  auto it = self->frameIndex.find(name);
+  if(it!=self->frameIndex.end()) {
+    uint id = reverse ? it->second.last() : it->second.first();
+    if(id<frames.N && frames.elem(id)->name==name) return frames.elem(id);
+    //the frame was renamed without reset_frameIndex()
+    if(!reverse) { for(Frame* f: frames) if(f->name==name) return f; }
+    else for(uint i=frames.N; i--;) if(frames.elem(i)->name==name) return frames.elem(i);
+  }
   if(!reverse) {
-    for(Frame* b: frames) if(b->name==name) return b;
-  } else {
-    for(uint i=frames.N; i--;) if(frames.elem(i)->name==name) return frames.elem(i);
+    for(uint i=nIndexed; i<frames.N; i++) if(frames.elem(i)->name==name) return frames.elem(i);
   }
   if(warnIfNotExist) RAI_MSG("cannot find frame named '" <<name <<"'");
   return 0;
@@ -782,7 +862,7 @@ double Configuration::getEnergy(const arr& qdot) {
   return E;
 }
 
-/// get the sum of all shape penetrations -- PRECONDITION: proxies have been computed (with stepSwift() or stepFcl())
+/// get the sum of all shape penetrations -- PRECONDITION: proxies have been computed (with stepSwift(), stepFcl() or stepBroadphase())
 double Configuration::getTotalPenetration() {
   CHECK(_state_proxies_isGood, "");
 
@@ -871,6 +951,21 @@ void Configuration::clear() {
   _state_proxies_isGood=false;
 }
 
+void Configuration::reset_frameIndex() {
+  if(self) self->calc_frameIndex(frames);
+}
+
+void Configuration::unindexFrame(Frame* f) {
+  if(!self) return;
+  if(f->ID+1!=frames.N || f->ID+1!=self->frameIndex_N) return; //only the last frame is removed without re-indexing
+  auto it = self->frameIndex.find(f->name.p?f->name.p:"");
+  if(it!=self->frameIndex.end() && it->second.N && it->second.last()==f->ID) {
+    it->second.popLast();
+    if(!it->second.N) self->frameIndex.erase(it);
+  }
+  self->frameIndex_N--;
+}
+
 /// clear the q-vector
 void Configuration::reset_q() {
   q.clear();
@@ -985,6 +1080,7 @@ void Configuration::sortFrames() {
   frames = calc_topSort();
   uint i=0;
   for(Frame* f: frames) f->ID = i++;
+  reset_frameIndex();
 }
 
 void Configuration::makeObjectsFree(const StringA& objects, double H_cost) {
@@ -1251,6 +1347,137 @@ FrameL Configuration::getCollisionAllPairs(){
 void Configuration::prefixNames(bool clear) {
   if(!clear) for(Frame* a: frames) a->name=STRING('_' <<a->ID <<'_' <<a->name);
   else       for(Frame* a: frames) a->name.clear() <<a->ID;
+  reset_frameIndex();
+}
+
+struct sConfigurationCheckpoint {
+  struct FrameRecord {
+    Frame* frame=0;
+    int parent=-1;           ///< parent ID, -1 for roots
+    Transformation Q=0, X=0; ///< Q for frames with parent, X for roots
+    double tau=0.;
+    Joint* joint=0;          ///< to detect whether the joint is still the same; the following restore or recreate it
+    JointType jointType=JT_none;  //the joint properties that the Joint copy constructor copies:
+    bool jointActive=true;
+    double jointH=1., jointScale=1.;
+    arr jointLimits, jointQ0;
+    Vector jointAxis=0;
+    int jointMimic=-1;       ///< frame ID of the mimicked joint
+    bool jointUncertain=false;
+    arr jointSigma;          ///< sigma of the joint's Uncertainty
+    BodyType inertiaType=BT_none;
+  };
+  Array<FrameRecord> frames;
+  ForceExchangeL forces;
+  arr q;
+};
+
+ConfigurationCheckpoint::ConfigurationCheckpoint() : self(make_unique<sConfigurationCheckpoint>()) {}
+ConfigurationCheckpoint::~ConfigurationCheckpoint() {}
+
+void Configuration::saveCheckpoint(ConfigurationCheckpoint& cp) {
+  ensure_q();
+  sConfigurationCheckpoint& S = *cp.self;
+  S.frames.resize(frames.N);
+  for(Frame* f:frames) {
+    sConfigurationCheckpoint::FrameRecord& r = S.frames.elem(f->ID);
+    r.frame = f;
+    r.parent = f->parent ? f->parent->ID : -1;
+    if(f->parent) r.Q = f->Q; else r.X = f->X;
+    r.tau = f->tau;
+    r.joint = f->joint;
+    if(f->joint) {
+      Joint* j = f->joint;
+      r.jointType=j->type;  r.jointActive=j->active;  r.jointH=j->H;  r.jointScale=j->scale;
+      r.jointLimits=j->limits;  r.jointQ0=j->q0;  r.jointAxis=j->axis;
+      r.jointMimic = j->mimic ? j->mimic->frame->ID : -1;
+      r.jointUncertain = j->uncertainty;
+      if(j->uncertainty) r.jointSigma = j->uncertainty->sigma;
+    } else r.jointType = JT_none;
+    r.inertiaType = f->inertia ? (BodyType)f->inertia->type : BT_none;
+  }
+  S.forces = forces;
+  S.q = q;
+}
+
+void Configuration::restoreCheckpoint(const ConfigurationCheckpoint& cp) {
+  const sConfigurationCheckpoint& S = *cp.self;
+  CHECK_GE(frames.N, S.frames.N, "frames were deleted since the checkpoint -- cannot restore");
+  for(uint i=0; i<S.frames.N; i++) CHECK_EQ(frames.elem(i), S.frames.elem(i).frame, "frames were deleted or resorted since the checkpoint -- cannot restore");
+  for(ForceExchange* ex:S.forces) CHECK(forces.contains(ex), "force exchanges were deleted since the checkpoint -- cannot restore");
+  bool structureChanged=false;
+
+  //-- delete frames and force exchanges added since
+  while(frames.N>S.frames.N) { delete frames.last();  structureChanged=true; }
+  for(uint i=forces.N; i--;) if(!S.forces.contains(forces.elem(i))) { delete forces.elem(i);  structureChanged=true; }
+
+  //-- relink frames whose parent changed (unlink all first, to not create loops on the way)
+  FrameL relink;
+  for(Frame* f:frames) {
+    int p = f->parent ? f->parent->ID : -1;
+    if(p!=S.frames.elem(f->ID).parent) relink.append(f);
+  }
+  for(Frame* f:relink) if(f->parent) f->unLink();
+  for(Frame* f:relink) { int p=S.frames.elem(f->ID).parent;  if(p>=0) f->setParent(frames.elem(p)); }
+  if(relink.N) structureChanged=true;
+
+  //-- recreate joints that were removed or replaced, and restore all properties of the others
+  FrameL mimicking;
+  for(Frame* f:frames) {
+    const sConfigurationCheckpoint::FrameRecord& r = S.frames.elem(f->ID);
+    Joint* j = f->joint;
+    if(r.jointType==JT_none) {
+      if(j) { delete j;  structureChanged=true; }
+      continue;
+    }
+    if(j!=r.joint) {
+      if(j) delete j;
+      j = new Joint(*f, r.jointType);
+      structureChanged=true;
+    }
+    if(j->type!=r.jointType) { j->setType(r.jointType);  structureChanged=true; }
+    if(j->active!=r.jointActive) { j->active=r.jointActive;  structureChanged=true; }
+    j->H=r.jointH;  j->scale=r.jointScale;
+    j->limits=r.jointLimits;  j->q0=r.jointQ0;  j->axis=r.jointAxis;
+    if(!r.jointUncertain && j->uncertainty) { delete j->uncertainty;  j->uncertainty=nullptr;  structureChanged=true; }
+    if(r.jointUncertain) {
+      if(!j->uncertainty) { new Uncertainty(j);  structureChanged=true; }
+      j->uncertainty->sigma = r.jointSigma;
+    }
+    if((j->mimic ? (int)j->mimic->frame->ID : -1) != r.jointMimic) {
+      j->setMimic(nullptr);
+      if(r.jointMimic>=0) mimicking.append(f);
+      structureChanged=true;
+    }
+  }
+  for(Frame* f:mimicking) f->joint->setMimic(frames.elem(S.frames.elem(f->ID).jointMimic)->joint);
+
+  for(Frame* f:frames) {
+    const sConfigurationCheckpoint::FrameRecord& r = S.frames.elem(f->ID);
+    if(f->inertia) f->inertia->type=r.inertiaType;
+    f->tau = r.tau;
+  }
+
+  //-- relative transforms (absolute for roots), invalidating only the branches that changed
+  for(Frame* f:frames) {
+    const sConfigurationCheckpoint::FrameRecord& r = S.frames.elem(f->ID);
+    if(f->parent) {
+      if(f->Q==r.Q) continue;
+      f->Q = r.Q;
+      f->_state_setXBadinBranch();
+    } else {
+      if(f->X==r.X) continue;
+      f->X = r.X;
+      f->_state_setXBadinBranch();
+      f->_state_X_isGood = true;
+    }
+  }
+
+  //-- joint state: if the structure is unchanged, the saved q is still indexed right; otherwise recompute it from the Qs
+  proxies.clear();
+  _state_proxies_isGood=false;
+  if(structureChanged) reset_q();
+  else setJointState(S.q);
 }
 
 void Configuration::calc_indexedActiveJoints(bool resetActiveJointSet) {
@@ -1396,6 +1623,105 @@ void Configuration::calc_Q_from_q() {
   CHECK_EQ(n, q.N, "");
 }
 
+void Configuration::prepareSharedReading() {
+  ensure_indexedJoints();
+  ensure_q();
+  calc_X_batch();
+  for(Frame* f:frames) if(f->shape) { f->shape->sscCore();  f->shape->mesh(); }
+}
+
+bool Configuration::isPreparedForSharedReading() const {
+  if(!_state_indexedJoints_areGood || !_state_q_isGood) return false;
+  for(Frame* f:frames) {
+    if(!f->_state_X_isGood) return false;
+    if(f->shape && (!f->shape->_mesh || !f->shape->_sscCore)) return false;
+  }
+  return true;
+}
+
+/// same poses as calling ensure_X() on all frames (up to rounding), but in a single pass over flat pose buffers (gather, compose, scatter)
+void Configuration::calc_X_batch() {
+  sConfiguration& S = *self;
+  if(!S.check_poseOrder(frames)) S.calc_poseOrder(*this);
+
+  //-- gather: absolute poses of up-to-date frames, relative transforms Q of outdated ones
+  uint N = S.poseOrder.N, nBad=0;
+  S.posePos.resize(3, N);  S.poseRot.resize(4, N);
+  S.relPos.resize(3, N);  S.relRot.resize(4, N);
+  S.poseFlags.resize(N);
+  double *px=S.posePos.p, *py=px+N, *pz=py+N;
+  double *qw=S.poseRot.p, *qx=qw+N, *qy=qx+N, *qz=qy+N;
+  double *rx=S.relPos.p, *ry=rx+N, *rz=ry+N;
+  double *sw=S.relRot.p, *sx=sw+N, *sy=sx+N, *sz=sy+N;
+  byte* flags=S.poseFlags.p;
+  for(uint i=0; i<N; i++) {
+    Frame* f = S.poseOrder.p[i];
+    if(f->_state_X_isGood || !f->parent) {
+      const Transformation& X = f->X;
+      px[i]=X.pos.x;  py[i]=X.pos.y;  pz[i]=X.pos.z;
+      qw[i]=X.rot.w;  qx[i]=X.rot.x;  qy[i]=X.rot.y;  qz[i]=X.rot.z;
+      flags[i] = X.rot.isZero ? 8 : 0;
+    } else {
+      const Transformation& Q = f->Q;
+      rx[i]=Q.pos.x;  ry[i]=Q.pos.y;  rz[i]=Q.pos.z;
+      sw[i]=Q.rot.w;  sx[i]=Q.rot.x;  sy[i]=Q.rot.y;  sz[i]=Q.rot.z;
+      flags[i] = 1 | (Q.pos.isZero ? 2 : 0) | (Q.rot.isZero ? 4 : 0);
+      nBad++;
+    }
+  }
+  if(!nBad) return;
+
+  //-- compose X = parent->X * Q (as Transformation::appendTransformation, but with a different summation order); parents precede children in the buffers
+  const int* parent = S.poseParent.p;
+  for(uint i=0; i<N; i++) {
+    if(!(flags[i]&1)) continue;
+    uint p = parent[i];
+    double bw=qw[p], bx=qx[p], by=qy[p], bz=qz[p];
+    bool parentRotIsZero = flags[p]&8;
+    //position
+    double ax=px[p], ay=py[p], az=pz[p];
+    if(!(flags[i]&2)) {
+      double cx=rx[i], cy=ry[i], cz=rz[i];
+      if(parentRotIsZero) {
+        ax+=cx;  ay+=cy;  az+=cz;
+      } else {
+        double Bx=2.*bx, By=2.*by, Bz=2.*bz;
+        double q11=bx*Bx, q22=by*By, q33=bz*Bz, q12=bx*By, q13=bx*Bz, q23=by*Bz, q01=bw*Bx, q02=bw*By, q03=bw*Bz;
+        ax += (1.-q22-q33)*cx + (q12-q03)*cy + (q13+q02)*cz;
+        ay += (q12+q03)*cx + (1.-q11-q33)*cy + (q23-q01)*cz;
+        az += (q13-q02)*cx + (q23+q01)*cy + (1.-q11-q22)*cz;
+      }
+    }
+    px[i]=ax;  py[i]=ay;  pz[i]=az;
+    //rotation
+    if(flags[i]&4) {
+      qw[i]=bw;  qx[i]=bx;  qy[i]=by;  qz[i]=bz;
+      if(parentRotIsZero) flags[i] |= 8;
+    } else if(parentRotIsZero) {
+      qw[i]=sw[i];  qx[i]=sx[i];  qy[i]=sy[i];  qz[i]=sz[i];
+    } else {
+      double cw=sw[i], cx=sx[i], cy=sy[i], cz=sz[i];
+      qw[i] = bw*cw - bx*cx - by*cy - bz*cz;
+      qx[i] = bx*cw + bw*cx - bz*cy + by*cz;
+      qy[i] = by*cw + bz*cx + bw*cy - bx*cz;
+      qz[i] = bz*cw - by*cx + bx*cy + bw*cz;
+    }
+  }
+
+  //-- scatter back into the frames (in order, so that parents' tau and X are set before their children read them)
+  for(uint i=0; i<N; i++) {
+    if(!(flags[i]&1)) continue;
+    Frame* f = S.poseOrder.p[i];
+    f->X.pos.set(px[i], py[i], pz[i]);
+    f->X.rot.set(qw[i], qx[i], qy[i], qz[i]);
+    CHECK_EQ(f->X.pos.x, f->X.pos.x, "NAN transformation:" <<f->parent->X <<'*' <<f->Q);
+    f->tau = f->parent->tau;
+    if(f->joint) f->joint->calc_axis_from_parent();
+    f->_state_X_isGood = true;
+  }
+  _state_proxies_isGood = false;
+}
+
 arr Configuration::calc_fwdPropagateVelocities(const arr& qdot) {
   CHECK(check_topSort(), "this needs a top sorted configuration")
   arr vel(frames.N, 2, 3);  //for every frame we have a linVel and angVel, each 3D
@@ -1478,15 +1804,36 @@ void Configuration::kinematicsZero(arr& y, arr& J, uint n) const {
 }
 
 /// what is the linear velocity of a world point (pos_world) attached to frame a for a given joint velocity?
-void Configuration::jacobian_pos(arr& J, Frame* a, const Vector& pos_world) const {
-  CHECK_EQ(&a->C, this, "");
+//-- the Jacobians only need, along the path to the root, the frames' absolute and relative poses and the joint axes:
+//   Configuration reads them from its frames, KinematicState from its own buffers
 
-  a->ensure_X();
+struct FramePoses {
+  const Transformation& X(Frame* f) const { return f->get_X(); }
+  const Transformation& Q(Frame* f) const { return f->get_Q(); }
+  Vector axis(Joint* j) const { return j->axis; }
+};
 
-  uint N=getJointStateDimension();
-  jacobian_zero(J, 3);
-  if(!J) return;
+struct StatePoses {
+  const KinematicState& S;
+  const Transformation& X(Frame* f) const { return S.X.elem(f->ID); }
+  const Transformation& Q(Frame* f) const { return S.Q.elem(f->ID); }
+  Vector axis(Joint* j) const { Vector axis=0; j->calcAxis(axis, S.X.elem(j->from()->ID).rot); return axis; }
+};
+
+//rotation rate (world coordinates) w.r.t. the 4 (not necessarily normalized) quaternion dofs qj of a ball joint with
+//upstream rotation R and relative rotation Q: a 3x4 block, entirely on the stack
+static FixedArray<double, 3, 4> quatBallJacobian(const Quaternion& R, const Quaternion& Q, const double* qj, double scale) {
+  arr33 Rm;
+  FixedArray<double, 3, 4> JQ;
+  R.getMatrix(Rm.p);
+  Q.getJacobian(JQ.p);
+  FixedArray<double, 3, 4> Jrot = Rm * JQ; //transform w-vectors into world coordinate
+  Jrot *= scale/sqrt(qj[0]*qj[0]+qj[1]*qj[1]+qj[2]*qj[2]+qj[3]*qj[3]); //account for the potential non-normalization of q
+  return Jrot;
+}
 
+template<class Poses> void jacobian_pos_(arr& J, Frame* a, const Vector& pos_world, const arr& q, const Poses& P) {
+  uint N=q.N;
   while(a) { //loop backward down the kinematic tree
     if(!a->parent) break; //frame has no inlink -> done
     Joint* j=a->joint;
@@ -1494,47 +1841,53 @@ void Configuration::jacobian_pos(arr& J, Frame* a, const Vector& pos_world) cons
       uint j_idx=j->qIndex;
       if(j_idx>=N) if(j->active) CHECK_EQ(j->type, JT_rigid, "");
       if(j_idx<N) {
+        const Transformation& jX = P.X(j->from());
         if(j->type==JT_hingeX || j->type==JT_hingeY || j->type==JT_hingeZ) {
-          Vector tmp = j->axis ^ (pos_world-j->X()*j->Q().pos);
+          Vector tmp = P.axis(j) ^ (pos_world-jX*P.Q(a).pos);
           tmp *= j->scale;
           J.elem(0, j_idx) += tmp.x;
           J.elem(1, j_idx) += tmp.y;
           J.elem(2, j_idx) += tmp.z;
         } else if(j->type==JT_transX || j->type==JT_transY || j->type==JT_transZ || j->type==JT_XBall) {
-          J.elem(0, j_idx) += j->scale * j->axis.x;
-          J.elem(1, j_idx) += j->scale * j->axis.y;
-          J.elem(2, j_idx) += j->scale * j->axis.z;
+          Vector axis = P.axis(j);
+          J.elem(0, j_idx) += j->scale * axis.x;
+          J.elem(1, j_idx) += j->scale * axis.y;
+          J.elem(2, j_idx) += j->scale * axis.z;
         } else if(j->type==JT_transXY) {
-          arr R = j->X().rot.getArr();
+          arr33 R;
+          jX.rot.getMatrix(R.p);
           R *= j->scale;
-          J.setMatrixBlock(R.sub(0, -1, 0, 1), 0, j_idx);
+          J.setMatrixBlock(R.cols<2>(0), 0, j_idx);
         } else if(j->type==JT_transXYPhi) {
-          arr R = j->X().rot.getArr();
+          arr33 R;
+          jX.rot.getMatrix(R.p);
           R *= j->scale;
-          J.setMatrixBlock(R.sub(0, -1, 0, 1), 0, j_idx);
-          Vector tmp = j->axis ^ (pos_world-(j->X().pos + j->X().rot*a->Q.pos));
+          J.setMatrixBlock(R.cols<2>(0), 0, j_idx);
+          Vector tmp = P.axis(j) ^ (pos_world-(jX.pos + jX.rot*P.Q(a).pos));
           tmp *= j->scale;
           J.elem(0, j_idx+2) += tmp.x;
           J.elem(1, j_idx+2) += tmp.y;
           J.elem(2, j_idx+2) += tmp.z;
         } else if(j->type==JT_phiTransXY) {
-          Vector tmp = j->axis ^ (pos_world-j->X().pos);
+          Vector tmp = P.axis(j) ^ (pos_world-jX.pos);
           tmp *= j->scale;
           J.elem(0, j_idx) += tmp.x;
           J.elem(1, j_idx) += tmp.y;
           J.elem(2, j_idx) += tmp.z;
-          arr R = (j->X().rot*a->Q.rot).getArr();
+          arr33 R;
+          (jX.rot*P.Q(a).rot).getMatrix(R.p);
           R *= j->scale;
-          J.setMatrixBlock(R.sub(0, -1, 0, 1), 0, j_idx+1);
+          J.setMatrixBlock(R.cols<2>(0), 0, j_idx+1);
         }
         if(j->type==JT_XBall) {
-          arr R = conv_vec2arr(j->X().rot.getX());
+          Vector x = jX.rot.getX();
+          FixedArray<double, 3, 1> R = {{x.x, x.y, x.z}};
           R *= j->scale;
-          R.reshape(3, 1);
           J.setMatrixBlock(R, 0, j_idx);
         }
         if(j->type==JT_trans3 || j->type==JT_free) {
-          arr R = j->X().rot.getArr();
+          arr33 R;
+          jX.rot.getMatrix(R.p);
           R *= j->scale;
           J.setMatrixBlock(R, 0, j_idx);
         }
@@ -1542,32 +1895,24 @@ void Configuration::jacobian_pos(arr& J, Frame* a, const Vector& pos_world) cons
           uint offset = 0;
           if(j->type==JT_XBall) offset=1;
           if(j->type==JT_free) offset=3;
-          arr Jrot = j->X().rot.getArr() * a->Q.rot.getJacobian(); //transform w-vectors into world coordinate
-          Jrot = crossProduct(Jrot, conv_vec2arr(pos_world-(j->X().pos+j->X().rot*a->Q.pos)));  //cross-product of all 4 w-vectors with lever
-          Jrot /= sqrt(sumOfSqr(q({j->qIndex+offset, j->qIndex+offset+3})));   //account for the potential non-normalization of q
-          //          for(uint i=0;i<4;i++) for(uint k=0;k<3;k++) J.elem(k,j_idx+offset+i) += Jrot(k,i);
-          Jrot *= j->scale;
+          FixedArray<double, 3, 4> Jrot = quatBallJacobian(jX.rot, P.Q(a).rot, q.p+j->qIndex+offset, j->scale);
+          Vector l = pos_world-(jX.pos+jX.rot*P.Q(a).pos);
+          for(uint i=0; i<4; i++) { //cross-product of all 4 w-vectors with lever
+            double w0=Jrot(0, i), w1=Jrot(1, i), w2=Jrot(2, i);
+            Jrot(0, i) = w1*l.z - w2*l.y;
+            Jrot(1, i) = w2*l.x - w0*l.z;
+            Jrot(2, i) = w0*l.y - w1*l.x;
+          }
           J.setMatrixBlock(Jrot, 0, j_idx+offset);
         }
       }
     }
     a = a->parent;
   }
-
-//  if(isSparseMatrix(J) && xIndex) {
-//    J.sparse().reshape(J.d0, J.d1+xIndex);
-//    J.sparse().rowShift(xIndex);
-//  }
 }
 
-/// what is the angular velocity of frame a for a given joint velocity?
-void Configuration::jacobian_angular(arr& J, Frame* a) const {
-  a->ensure_X();
-
-  uint N = getJointStateDimension();
-  jacobian_zero(J, 3);
-  if(!J) return;
-
+template<class Poses> void jacobian_angular_(arr& J, Frame* a, const arr& q, const Poses& P) {
+  uint N=q.N;
   while(a) { //loop backward down the kinematic tree
     Joint* j=a->joint;
     if(j && j->active) {
@@ -1576,19 +1921,16 @@ void Configuration::jacobian_angular(arr& J, Frame* a) const {
       if(j_idx<N) {
         if((j->type>=JT_hingeX && j->type<=JT_hingeZ) || j->type==JT_transXYPhi || j->type==JT_phiTransXY) {
           if(j->type==JT_transXYPhi) j_idx += 2; //refer to the phi only
-          J.elem(0, j_idx) += j->scale * j->axis.x;
-          J.elem(1, j_idx) += j->scale * j->axis.y;
-          J.elem(2, j_idx) += j->scale * j->axis.z;
+          Vector axis = P.axis(j);
+          J.elem(0, j_idx) += j->scale * axis.x;
+          J.elem(1, j_idx) += j->scale * axis.y;
+          J.elem(2, j_idx) += j->scale * axis.z;
         }
         if(j->type==JT_quatBall || j->type==JT_free || j->type==JT_XBall) {
           uint offset = 0;
           if(j->type==JT_XBall) offset=1;
           if(j->type==JT_free) offset=3;
-          arr Jrot = j->X().rot.getArr() * a->get_Q().rot.getJacobian(); //transform w-vectors into world coordinate
-          Jrot /= sqrt(sumOfSqr(q({j->qIndex+offset, j->qIndex+offset+3}))); //account for the potential non-normalization of q
-          //          for(uint i=0;i<4;i++) for(uint k=0;k<3;k++) J.elem(k,j_idx+offset+i) += Jrot(k,i);
-          Jrot *= j->scale;
-          J.setMatrixBlock(Jrot, 0, j_idx+offset);
+          J.setMatrixBlock(quatBallJacobian(P.X(j->from()).rot, P.Q(a).rot, q.p+j->qIndex+offset, j->scale), 0, j_idx+offset);
         }
         //all other joints: J=0 !!
       }
@@ -1597,6 +1939,34 @@ void Configuration::jacobian_angular(arr& J, Frame* a) const {
   }
 }
 
+void Configuration::jacobian_pos(arr& J, Frame* a, const Vector& pos_world) const {
+  CHECK_EQ(&a->C, this, "");
+
+  a->ensure_X();
+
+  jacobian_zero(J, 3);
+  if(!J) return;
+
+  ((Configuration*)this)->ensure_q();
+  jacobian_pos_(J, a, pos_world, q, FramePoses());
+
+//  if(isSparseMatrix(J) && xIndex) {
+//    J.sparse().reshape(J.d0, J.d1+xIndex);
+//    J.sparse().rowShift(xIndex);
+//  }
+}
+
+/// what is the angular velocity of frame a for a given joint velocity?
+void Configuration::jacobian_angular(arr& J, Frame* a) const {
+  a->ensure_X();
+
+  jacobian_zero(J, 3);
+  if(!J) return;
+
+  ((Configuration*)this)->ensure_q();
+  jacobian_angular_(J, a, q, FramePoses());
+}
+
 /// how does the time coordinate of frame a change with q-change?
 void Configuration::jacobian_tau(arr& J, Frame* a) const {
   HALT("use kinematicsTau?");
@@ -1890,6 +2260,17 @@ std::shared_ptr<FclInterface> Configuration::fcl() {
   return self->fcl;
 }
 
+/// return the native (AABB tree) broadphase
+std::shared_ptr<BroadphaseInterface> Configuration::broadphase() {
+  if(self->broadphase && !self->broadphase->isUpToDate(frames)) self->broadphase.reset();
+  if(!self->broadphase){
+    self->broadphase = make_shared<BroadphaseInterface>(frames, .1);
+    self->broadphase->deactivate(getCollisionExcludeIDs());
+    self->broadphase->deactivatePairs(getCollisionExcludePairIDs());
+  }
+  return self->broadphase;
+}
+
 void Configuration::swiftDelete() {
   self->swift.reset();
 }
@@ -2028,6 +2409,14 @@ void Configuration::stepFcl() {
   _state_proxies_isGood=true;
 }
 
+void Configuration::stepBroadphase() {
+  uintA collisionPairs = broadphase()->step(frames);
+  proxies.clear();
+  addProxies(collisionPairs);
+
+  _state_proxies_isGood=true;
+}
+
 void Configuration::stepPhysx(double tau) {
   physx().step(tau);
 }
@@ -2150,7 +2539,9 @@ void Configuration::copyProxies(const ProxyA& _proxies) {
 
 /// prototype for \c operator<<
 void Configuration::write(std::ostream& os) const {
-  for(Frame* f: frames) if(!f->name.N) f->name <<'_' <<f->ID;
+  bool renamed=false;
+  for(Frame* f: frames) if(!f->name.N) { f->name <<'_' <<f->ID; renamed=true; }
+  if(renamed) self->calc_frameIndex(frames);
   for(Frame* f: frames) { //fwdActiveSet) {
     //    os <<"frame " <<f->name;
     //    if(f->parent) os <<'(' <<f->parent->name <<')';
@@ -2179,7 +2570,9 @@ void Configuration::write(std::ostream& os) const {
 }
 
 void Configuration::write(Graph& G) const {
-  for(Frame* f: frames) if(!f->name.N) f->name <<'_' <<f->ID;
+  bool renamed=false;
+  for(Frame* f: frames) if(!f->name.N) { f->name <<'_' <<f->ID; renamed=true; }
+  if(renamed) self->calc_frameIndex(frames);
   for(Frame* f: frames) f->write(G.newSubgraph({f->name}));
 }
 
@@ -2469,6 +2862,7 @@ void Configuration::report(std::ostream& os) const {
 }
 
 void Configuration::readFromGraph(const Graph& G, bool addInsteadOfClear) {
+  rai::MemoryTagScope memTag(rai::MT_Kin);
   if(!addInsteadOfClear) clear();
 
   FrameL node2frame(G.N);
@@ -2600,6 +2994,8 @@ void Configuration::readFromGraph(const Graph& G, bool addInsteadOfClear) {
     j->read(*f->ats);
   }
 
+  self->index_appendedFrames(frames);
+
   //if the joint is coupled to another:
   {
     Joint* j;
@@ -2708,8 +3104,23 @@ void Configuration::kinematicsPenetration(arr& y, arr& J, double margin) const {
 
   y.resize(1).setZero();
   jacobian_zero(J, 1);
-  for(const Proxy& p:proxies) { /*if(p.d<margin)*/
-    kinematicsPenetration(y, J, p, margin, true);
+
+  //-- batched distances for proxies without collision geometry yet: only those within the margin need a full PairCollision
+  PairCollisionBatch batch;
+  intA batchIndex(proxies.N);
+  for(uint i=0; i<proxies.N; i++) {
+    const Proxy& p = proxies(i);
+    batchIndex(i) = -1;
+    if(p.collision || p.d > p.a->shape->radius() + p.b->shape->radius() + .01 + margin) continue;
+    double r1, r2;
+    Mesh &m1=getCollisionMesh(r1, p.a), &m2=getCollisionMesh(r2, p.b);
+    batchIndex(i) = batch.add(m1, m2, p.a->ensure_X(), p.b->ensure_X(), r1, r2);
+  }
+  batch.compute();
+
+  for(uint i=0; i<proxies.N; i++) {
+    if(batchIndex(i)>=0 && batch.distance(batchIndex(i))>margin) continue;
+    kinematicsPenetration(y, J, proxies(i), margin, true);
   }
 }
 
@@ -3422,6 +3833,94 @@ void editConfiguration(const char* filename, Configuration& C) {
   }
 }
 
+//===========================================================================
+//
+// KinematicState
+//
+
+KinematicState::KinematicState(const Configuration& _C) : C(_C) {
+  CHECK(C.isPreparedForSharedReading(), "the model has lazy state left -- call prepareSharedReading() before creating KinematicState's on it");
+
+  order = framesToIndices(C.calc_topSort());
+  Q.resize(C.frames.N);
+  X.resize(C.frames.N);
+  for(Frame* f:C.frames) {
+    Q.elem(f->ID) = f->get_Q();
+    X.elem(f->ID) = f->get_X();
+  }
+  q = C.q;
+}
+
+void KinematicState::setJointState(const arr& _q) {
+  CHECK_EQ(_q.N, C.q.N, "joint state has wrong dimension");
+  q = _q;
+
+  //-- relative transforms of the active joints (mimicking joints copy theirs after)
+  for(Dof* d:C.activeJoints) {
+    const Joint* j = d->joint();
+    if(!j || j->type==JT_rigid || j->type==JT_tau || j->mimic) continue;
+    j->calcQ(Q.elem(j->frame->ID), q, j->qIndex);
+  }
+  for(Dof* d:C.activeJoints) {
+    const Joint* j = d->joint();
+    if(j && j->mimic && j->type!=JT_tau) Q.elem(j->frame->ID) = Q.elem(j->mimic->frame->ID);
+  }
+
+  //-- absolute poses, parents first
+  for(uint i:order) {
+    Frame* f = C.frames.elem(i);
+    if(f->parent) {
+      X.elem(i) = X.elem(f->parent->ID);
+      X.elem(i).appendTransformation(Q.elem(i));
+    }
+  }
+}
+
+void KinematicState::kinematicsPos(arr& y, arr& J, Frame* a, const Vector& rel) const {
+  CHECK_EQ(&a->C, &C, "given frame is not element of the state's Configuration");
+
+  const Transformation& Xa = X.elem(a->ID);
+  Vector pos_world = Xa.pos;
+  if(!!rel && !rel.isZero) pos_world += Xa.rot*rel;
+  if(!!y) y = conv_vec2arr(pos_world);
+  if(!!J) jacobian_pos(J, a, pos_world);
+}
+
+void KinematicState::kinematicsQuat(arr& y, arr& J, Frame* a) const {
+  CHECK_EQ(&a->C, &C, "given frame is not element of the state's Configuration");
+
+  const Quaternion& rot_a = X.elem(a->ID).rot;
+  if(!!y) y = rot_a.getArr4d();
+  if(!!J) {
+    arr A;
+    jacobian_angular(A, a);
+    J.resize(4, A.d1).setZero();
+    J.setMatrixBlock(A, 1, 0);
+    J *= .5;
+    J = rot_a.getQuaternionMultiplicationMatrix() * J;
+  }
+}
+
+void KinematicState::jacobian_pos(arr& J, Frame* a, const Vector& pos_world) const {
+  J.resize(3, q.N).setZero();
+  jacobian_pos_(J, a, pos_world, q, StatePoses{*this});
+}
+
+void KinematicState::jacobian_angular(arr& J, Frame* a) const {
+  J.resize(3, q.N).setZero();
+  jacobian_angular_(J, a, q, StatePoses{*this});
+}
+
+shared_ptr<PairCollision> KinematicState::collision(Frame* a, Frame* b) const {
+  CHECK(a->shape && b->shape, "both frames need a shape");
+
+  //the same geometry as proxies and collision features
+  double r1, r2;
+  Mesh &m1=getCollisionMesh(r1, a), &m2=getCollisionMesh(r2, b);
+
+  return make_shared<PairCollision>(m1, m2, X.elem(a->ID), X.elem(b->ID), r1, r2);
+}
+
 }//namespace
 
 //===========================================================================
@@ -16,8 +16,11 @@
 struct OpenGL;
 struct PhysXInterface;
 struct SwiftInterface;
+struct BroadphaseInterface;
+struct SliceBroadphaseInterface;
 struct OdeInterface;
 struct FeatherstoneInterface;
+struct PairCollision;
 
 //===========================================================================
 
@@ -164,6 +167,7 @@ struct Configuration : GLDrawer {
   /// @name structural operations, changes of configuration
   void clear();
   void reset_q();
+  void reset_frameIndex(); ///< rebuild the name->frame index used by getFrame() (needed after renaming existing frames)
   void reconfigureRoot(Frame* newRoot, bool ofLinkOnly);  ///< n becomes the root of the kinematic tree; joints accordingly reversed; lists resorted
   void flipFrames(Frame* a, Frame* b);
   void pruneRigidJoints();        ///< delete rigid joints -> they become just links
@@ -182,10 +186,15 @@ struct Configuration : GLDrawer {
   uintA getCollisionExcludePairIDs(bool verbose=false);
   FrameL getCollisionAllPairs();
   void prefixNames(bool clear=false);
+  void saveCheckpoint(struct ConfigurationCheckpoint& cp);
+  void restoreCheckpoint(const struct ConfigurationCheckpoint& cp);
 
   /// @name computations on the tree
   void calc_indexedActiveJoints(bool resetActiveJointSet=true); ///< sort of private: count the joint dimensionalities and assign j->q_index
   void calc_Q_from_q();  ///< from q compute the joint's Q transformations
+  void prepareSharedReading();  ///< settle all lazy state (joint index, q, all frame poses, shape meshes) -- required before creating KinematicState's on this
+  bool isPreparedForSharedReading() const;
+  void calc_X_batch();  ///< fwd kinematics of all frames with outdated X in one pass over flat (structure-of-arrays) pose buffers, in topological order
   void calcDofsFromConfig();  ///< updates q based on the joint's Q transformations
   arr calc_fwdPropagateVelocities(const arr& qdot);    ///< elementary forward kinematics
 
@@ -236,6 +245,7 @@ struct Configuration : GLDrawer {
   shared_ptr<ConfigurationViewer>& gl(const char* window_title=nullptr, bool offscreen=false);
   shared_ptr<SwiftInterface> swift();
   shared_ptr<FclInterface> fcl();
+  shared_ptr<BroadphaseInterface> broadphase();
   void swiftDelete();
   PhysXInterface& physx();
   OdeInterface& ode();
@@ -248,6 +258,7 @@ struct Configuration : GLDrawer {
   void glClose();
   void stepSwift();
   void stepFcl();
+  void stepBroadphase();
   void stepPhysx(double tau);
   void stepOde(double tau);
   void stepDynamics(arr& qdot, const arr& u_control, double tau, double dynamicNoise = 0.0, bool gravity = true);
@@ -270,12 +281,51 @@ struct Configuration : GLDrawer {
 
 private:
   void readFromGraph(const Graph& G, bool addInsteadOfClear=false);
+  void unindexFrame(Frame* f); ///< called by ~Frame before removing the last frame
+  friend struct Frame;
   friend struct KinematicSwitch;
   friend void editConfiguration(const char* orsfile, Configuration& G);
 };
 
 stdPipes(Configuration)
 
+//===========================================================================
+
+/// snapshot of a Configuration's state (joint state, relative transforms, tree links, joints, force exchanges) to
+/// roll back cheaply, e.g. in tree search, instead of copying the configuration. Restoring only touches what changed;
+/// frames added since are deleted, frames deleted since cannot be restored
+struct ConfigurationCheckpoint {
+  unique_ptr<struct sConfigurationCheckpoint> self;
+  ConfigurationCheckpoint();
+  ~ConfigurationCheckpoint();
+};
+
+//===========================================================================
+
+/// per-thread kinematic state (joint vector and frame poses) on a shared Configuration that is only read:
+/// many states can run kinematics and collision queries concurrently on the same model without copying it.
+/// The model has to be prepared with C.prepareSharedReading() before (states never write to it), has to outlive
+/// the states, and must not be changed structurally (nor its rigid relative transforms) while states refer to it
+struct KinematicState {
+  const Configuration& C;     ///< the shared model
+  uintA order;                ///< frame IDs in topological order
+  arr q;                      ///< joint state (same layout as C.q)
+  Array<Transformation> Q, X; ///< relative and absolute pose for each frame ID
+
+  KinematicState(const Configuration& _C);
+
+  void setJointState(const arr& _q);
+
+  /// @name kinematics (Jacobians are always dense)
+  void kinematicsPos(arr& y, arr& J, Frame* a, const Vector& rel=NoVector) const;
+  void kinematicsQuat(arr& y, arr& J, Frame* a) const;
+  void jacobian_pos(arr& J, Frame* a, const Vector& pos_world) const;
+  void jacobian_angular(arr& J, Frame* a) const;
+
+  /// @name collision queries
+  shared_ptr<PairCollision> collision(Frame* a, Frame* b) const; ///< collision geometry of the two frames' shapes (as for proxies, see getCollisionMesh) at this state's poses; reentrant
+};
+
 //===========================================================================
 //
 // OpenGL static draw functions
@@ -291,6 +341,7 @@ StringA framesToNames(const FrameL& frames);
 //
 
 void makeConvexHulls(FrameL& frames, bool onlyContactShapes=true);
+void makeCollisionLODs(FrameL& frames); ///< coarse levels (Mesh::lod) for the collision meshes of all contact shapes
 void computeOptimalSSBoxes(FrameL& frames);
 void computeMeshNormals(FrameL& frames, bool force=false);
 void computeMeshGraphs(FrameL& frames, bool force=false);
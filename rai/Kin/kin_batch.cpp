@@ -0,0 +1,62 @@
+/*  ------------------------------------------------------------------
+    Copyright (c) 2011-2020 Marc Toussaint
+    email: toussaint@tu-berlin.de
+
+    This code is distributed under the MIT License.
+    Please see <root-path>/LICENSE for details.
+    --------------------------------------------------------------  */
+
+#include "kin_batch.h"
+#include "frame.h"
+
+namespace rai {
+
+KinematicsBatch::KinematicsBatch(const Configuration& _C, const uintA& _frameIDs, uint threads)
+  : C(_C), frameIDs(_frameIDs) {
+  CHECK_GE(threads, 1, "need at least one thread");
+  for(uint i:frameIDs) CHECK_LE(i+1, C.frames.N, "frame ID " <<i <<" out of range");
+  states.resize(threads);
+  for(shared_ptr<KinematicState>& S:states) S = make_shared<KinematicState>(C);
+  dof = C.q.N;
+}
+
+void KinematicsBatch::eval(arr& poses, arr& Jpos, arr& Jang, const arr& Q) {
+  CHECK_EQ(Q.nd, 2, "need a (N x dof) matrix of joint vectors");
+  CHECK_EQ(Q.d1, dof, "joint vectors have wrong dimension");
+  uint N=Q.d0, F=frameIDs.N;
+
+  poses.resize(N, F, 7);
+  if(!!Jpos) Jpos.resize(N, 3*F, dof);
+  if(!!Jang) Jang.resize(N, 3*F, dof);
+
+  //-- split the batch into contiguous chunks, one per state
+  uint T=states.N;
+#ifdef OPENMP
+#pragma omp parallel for num_threads(T) schedule(static)
+#endif
+  for(uint t=0; t<T; t++) {
+    KinematicState& S = *states(t);
+    arr Jp, Ja;
+    for(uint n=(t*N)/T; n<((t+1)*N)/T; n++) {
+      if(!!Jpos) Jp.referToDim(Jpos, n);
+      if(!!Jang) Ja.referToDim(Jang, n);
+      eval(S, &poses(n, 0, 0), (!!Jpos ? Jp : NoArr), (!!Jang ? Ja : NoArr), Q[n]);
+    }
+  }
+}
+
+void KinematicsBatch::eval(KinematicState& S, double* pose, arr& Jpos, arr& Jang, const arr& q) {
+  S.setJointState(q);
+  arr J;
+  for(uint f=0; f<frameIDs.N; f++) {
+    Frame* a = C.frames.elem(frameIDs(f));
+    const Transformation& X = S.X.elem(a->ID);
+    pose[0]=X.pos.x;  pose[1]=X.pos.y;  pose[2]=X.pos.z;
+    pose[3]=X.rot.w;  pose[4]=X.rot.x;  pose[5]=X.rot.y;  pose[6]=X.rot.z;
+    pose += 7;
+    if(!!Jpos) { S.jacobian_pos(J, a, X.pos);  Jpos.setMatrixBlock(J, 3*f, 0); }
+    if(!!Jang) { S.jacobian_angular(J, a);  Jang.setMatrixBlock(J, 3*f, 0); }
+  }
+}
+
+}//namespace rai
@@ -0,0 +1,38 @@
+/*  ------------------------------------------------------------------
+    Copyright (c) 2011-2020 Marc Toussaint
+    email: toussaint@tu-berlin.de
+
+    This code is distributed under the MIT License.
+    Please see <root-path>/LICENSE for details.
+    --------------------------------------------------------------  */
+
+#pragma once
+
+#include "kin.h"
+
+namespace rai {
+
+//===========================================================================
+
+/// evaluates poses (and Jacobians) of selected frames for many joint vectors in one call;
+/// each thread works on its own KinematicState of the shared configuration, which is only read -- so, as for
+/// KinematicState, C has to be prepared with C.prepareSharedReading() and has to outlive the batch (only a reference is kept)
+/// (the threads only run in parallel when built with OPENMP = 1 in config.mk; otherwise the chunks run sequentially)
+struct KinematicsBatch {
+  const Configuration& C;                   ///< the shared model
+  uintA frameIDs;                           ///< frames to evaluate
+  Array<shared_ptr<KinematicState>> states; ///< one state per thread
+  uint dof=0;                               ///< joint state dimension (columns of the joint matrix)
+
+  KinematicsBatch(const Configuration& C, const uintA& _frameIDs, uint threads=1);
+  KinematicsBatch(const Configuration& C, const StringA& frameNames, uint threads=1)
+    : KinematicsBatch(C, C.getFrameIDs(frameNames), threads) {}
+
+  /// for a (N x dof) matrix of joint vectors, return (N x F x 7) poses, and optionally (N x 3F x dof) position
+  /// and angular Jacobians (F = #frames; rows 3f..3f+2 belong to the f-th frame)
+  void eval(arr& poses, arr& Jpos, arr& Jang, const arr& Q);
+  /// evaluate a single joint vector on the given state; pose points to F*7 doubles, Jpos/Jang are (3F x dof) or NoArr
+  void eval(KinematicState& S, double* pose, arr& Jpos, arr& Jang, const arr& q);
+};
+
+}//namespace rai
@@ -0,0 +1,231 @@
+/*  ------------------------------------------------------------------
+    Copyright (c) 2011-2020 Marc Toussaint
+    email: toussaint@tu-berlin.de
+
+    This code is distributed under the MIT License.
+    Please see <root-path>/LICENSE for details.
+    --------------------------------------------------------------  */
+
+#include "kin_broadphase.h"
+#include "frame.h"
+
+//center and half extents of the shape's mesh in frame coordinates; false if the frame has no collision geometry
+static bool getLocalBox(double* b, rai::Frame* f) {
+  rai::Shape* s=f->shape;
+  if(!s || !s->cont) return false;
+  if(!s->mesh().V.N) s->createMeshes();
+  const arr& V = s->mesh().V;
+  if(!V.N) return false;
+  double lo[3], hi[3];
+  for(uint k=0; k<3; k++) lo[k]=hi[k]=V.p[k];
+  for(uint i=1; i<V.d0; i++) for(uint k=0; k<3; k++) {
+      double v=V.p[3*i+k];
+      if(v<lo[k]) lo[k]=v;
+      if(v>hi[k]) hi[k]=v;
+    }
+  for(uint k=0; k<3; k++) { b[k]=.5*(lo[k]+hi[k]);  b[3+k]=.5*(hi[k]-lo[k]); }
+  return true;
+}
+
+//world box (lo, hi) of a local box at pose X, inflated by 'inflate'
+static void getWorldBox(double* b, const double* local, const rai::Transformation& X, double inflate) {
+  const double* c=local, *h=local+3, *p=&X.pos.x;
+  double R[9];
+  X.rot.getMatrix(R);
+  for(uint k=0; k<3; k++) {
+    double center = p[k] + R[3*k]*c[0] + R[3*k+1]*c[1] + R[3*k+2]*c[2];
+    double half = fabs(R[3*k])*h[0] + fabs(R[3*k+1])*h[1] + fabs(R[3*k+2])*h[2] + inflate;
+    b[k] = center-half;
+    b[3+k] = center+half;
+  }
+}
+
+//revision of the mesh that getLocalBox uses; 0 if the frame has no collision geometry
+static uint getGeometryRevision(rai::Frame* f) {
+  rai::Shape* s=f->shape;
+  if(!s || !s->cont || !s->mesh().V.N) return 0;
+  return s->mesh().revision;
+}
+
+static bool hasActiveDofUpstream(rai::Frame* f) {
+  for(rai::Frame* a=f; a; a=a->parent) if(a->joint) {
+      rai::Joint* j = a->joint->mimic ? a->joint->mimic : a->joint;
+      if(j->active && j->dim) return true;
+    }
+  return false;
+}
+
+static bool boxesOverlap(const double* A, const double* B) {
+  return A[0]<=B[3] && B[0]<=A[3] && A[1]<=B[4] && B[1]<=A[4] && A[2]<=B[5] && B[2]<=A[5];
+}
+
+//===========================================================================
+
+BroadphaseInterface::BroadphaseInterface(const FrameL& frames, double _cutoff, double margin)
+  : tree(margin), cutoff(_cutoff) {
+  localBox.resize(frames.N, 6).setZero();
+  box.resize(frames.N, 6).setZero();
+  revision.resize(frames.N).setZero();
+  for(rai::Frame* f: frames) {
+    bool hasBox = getLocalBox(&localBox(f->ID, 0), f);
+    revision(f->ID) = getGeometryRevision(f);
+    if(!hasBox) continue;
+    shapeIDs.append(f->ID);
+    computeBox(f);
+    tree.insert(f->ID, &box(f->ID, 0), &box(f->ID, 3));
+  }
+}
+
+bool BroadphaseInterface::isUpToDate(const FrameL& frames) const {
+  if(frames.N!=revision.N) return false;
+  for(rai::Frame* f: frames) if(getGeometryRevision(f)!=revision(f->ID)) return false;
+  return true;
+}
+
+void BroadphaseInterface::computeBox(rai::Frame* f) {
+  getWorldBox(&box(f->ID, 0), &localBox(f->ID, 0), f->ensure_X(), .5*cutoff);
+}
+
+uintA BroadphaseInterface::step(const FrameL& frames) {
+  CHECK_EQ(frames.N, localBox.d0, "the frames have changed since the broadphase was initialized");
+  for(uint id: shapeIDs) {
+    computeBox(frames.elem(id));
+    tree.update(id, &box(id, 0), &box(id, 3));
+  }
+
+  uintA pairs;
+  tree.getOverlappingPairs(pairs);
+
+  //-- keep pairs that are not excluded and whose tight boxes overlap
+  uint n=0;
+  for(uint i=0; i<pairs.d0; i++) {
+    uint a=pairs(i, 0), b=pairs(i, 1);
+    if(excludedPairs.count(key(a, b))) continue;
+    if(!boxesOverlap(&box(a, 0), &box(b, 0))) continue;
+    pairs(n, 0)=a;  pairs(n, 1)=b;
+    n++;
+  }
+  pairs.resizeCopy(n, 2);
+  return pairs;
+}
+
+void BroadphaseInterface::deactivate(const uintA& collisionExcludeIDs) {
+  for(uint id: collisionExcludeIDs) if(tree.contains(id)) {
+      tree.remove(id);
+      shapeIDs.removeValue(id);
+    }
+}
+
+void BroadphaseInterface::deactivatePairs(const uintA& collisionExcludePairIDs) {
+  if(!collisionExcludePairIDs.N) return;
+  CHECK_EQ(collisionExcludePairIDs.nd, 2, "");
+  for(uint i=0; i<collisionExcludePairIDs.d0; i++) {
+    excludedPairs.insert(key(collisionExcludePairIDs(i, 0), collisionExcludePairIDs(i, 1)));
+  }
+}
+
+//===========================================================================
+
+SliceBroadphaseInterface::SliceBroadphaseInterface(const FrameL& timeSlices, uint sStart, double _cutoff, double margin)
+  : staticTree(margin), cutoff(_cutoff) {
+  CHECK_EQ(timeSlices.nd, 2, "need time slices as T x F frame array");
+  CHECK(sStart<timeSlices.d0, "sStart beyond the time slices");
+  uint T=timeSlices.d0, F=timeSlices.d1;
+  localBox.resize(F, 6).setZero();
+  isStatic.resize(F) = false;
+  box.resize(T, F, 6).setZero();
+  trees.resize(T);
+  for(uint s=sStart; s<T; s++) trees(s) = make_shared<rai::AABBTree>(margin);
+
+  for(uint j=0; j<F; j++) {
+    rai::Frame* f = timeSlices(sStart, j);
+    if(!getLocalBox(&localBox(j, 0), f)) continue;
+    shapeIDs.append(j);
+
+    //static: no active dof upstream in any slice (switches may attach it to a moving frame in some) -> the same pose in all slices
+    bool stat=true;
+    for(uint s=sStart; s<T && stat; s++) if(hasActiveDofUpstream(timeSlices(s, j))) stat=false;
+    isStatic(j) = stat;
+
+    if(stat) {
+      getWorldBox(&box(sStart, j, 0), &localBox(j, 0), f->ensure_X(), .5*cutoff);
+      staticTree.insert(j, &box(sStart, j, 0), &box(sStart, j, 3));
+      staticIDs.append(j);
+    } else {
+      for(uint s=sStart; s<T; s++) {
+        getWorldBox(&box(s, j, 0), &localBox(j, 0), timeSlices(s, j)->ensure_X(), .5*cutoff);
+        trees(s)->insert(j, &box(s, j, 0), &box(s, j, 3));
+      }
+      dynamicIDs.append(j);
+    }
+  }
+}
+
+uintA SliceBroadphaseInterface::step(const FrameL& timeSlices, uint sStart) {
+  CHECK(timeSlices.nd==2 && timeSlices.d0==box.d0 && timeSlices.d1==box.d1, "the time slices have changed since the broadphase was initialized");
+  uint T=timeSlices.d0;
+  uintA pairs, P, ids;
+
+  //-- static shapes: one box and one tree for all slices
+  for(uint j:staticIDs) {
+    getWorldBox(&box(sStart, j, 0), &localBox(j, 0), timeSlices(sStart, j)->ensure_X(), .5*cutoff);
+    staticTree.update(j, &box(sStart, j, 0), &box(sStart, j, 3));
+    for(uint s=sStart+1; s<T; s++) memmove(&box(s, j, 0), &box(sStart, j, 0), 6*box.sizeT);
+  }
+  uintA staticPairs;
+  staticTree.getOverlappingPairs(staticPairs);
+
+  for(uint s=sStart; s<T; s++) {
+    //-- move the dynamic shapes of this slice
+    rai::AABBTree& tree = *trees(s);
+    for(uint j:dynamicIDs) {
+      getWorldBox(&box(s, j, 0), &localBox(j, 0), timeSlices(s, j)->ensure_X(), .5*cutoff);
+      tree.update(j, &box(s, j, 0), &box(s, j, 3));
+    }
+
+    //-- candidates: static-static (same in all slices), dynamic-dynamic, dynamic-static
+    P = staticPairs;
+    tree.getOverlappingPairs(ids);
+    P.append(ids);
+    for(uint j:dynamicIDs) {
+      staticTree.query(ids, &box(s, j, 0), &box(s, j, 3));
+      for(uint k:ids) { P.append(std::min(j, k));  P.append(std::max(j, k)); }
+    }
+    P.reshape(P.N/2, 2);
+    appendPairs(pairs, P, timeSlices, s, &box(s, 0, 0));
+  }
+
+  pairs.reshape(pairs.N/2, 2);
+  return pairs;
+}
+
+void SliceBroadphaseInterface::appendPairs(uintA& pairs, const uintA& P, const FrameL& timeSlices, uint s, const double* boxes) {
+  for(uint i=0; i<P.d0; i++) {
+    uint a=P(i, 0), b=P(i, 1);
+    if(excludedPairs.count(key(a, b))) continue;
+    if(!boxesOverlap(boxes+6*a, boxes+6*b)) continue;
+    pairs.append(timeSlices(s, a)->ID);
+    pairs.append(timeSlices(s, b)->ID);
+  }
+}
+
+void SliceBroadphaseInterface::deactivate(const uintA& collisionExcludeIDs) {
+  for(uint j: collisionExcludeIDs) if(j<localBox.d0 && shapeIDs.contains(j)) {
+      shapeIDs.removeValue(j);
+      if(isStatic(j)) {
+        staticTree.remove(j);
+        staticIDs.removeValue(j);
+      } else {
+        for(auto& tree:trees) if(tree) tree->remove(j);
+        dynamicIDs.removeValue(j);
+      }
+    }
+}
+
+void SliceBroadphaseInterface::deactivatePairs(const uintA& collisionExcludePairIDs) {
+  if(!collisionExcludePairIDs.N) return;
+  CHECK_EQ(collisionExcludePairIDs.nd, 2, "");
+  for(uint i=0; i<collisionExcludePairIDs.d0; i++) {
+    excludedPairs.insert(key(collisionExcludePairIDs(i, 0), collisionExcludePairIDs(i, 1)));
+  }
+}
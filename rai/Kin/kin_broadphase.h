@@ -0,0 +1,67 @@
+/*  ------------------------------------------------------------------
+    Copyright (c) 2011-2020 Marc Toussaint
+    email: toussaint@tu-berlin.de
+
+    This code is distributed under the MIT License.
+    Please see <root-path>/LICENSE for details.
+    --------------------------------------------------------------  */
+
+#pragma once
+
+#include "kin.h"
+#include "../Geo/aabbTree.h"
+
+#include <unordered_set>
+
+/// native collision broadphase: a dynamic AABB tree over all shapes with contact (cont!=0), keyed by frame ID and
+/// fed directly from the frame poses; step() returns candidate pairs (frame IDs) whose boxes are closer than cutoff,
+/// which Configuration::addProxies turns into proxies (and PairCollision resolves on demand)
+struct BroadphaseInterface {
+  rai::AABBTree tree;
+  double cutoff;
+  uintA shapeIDs;    ///< frame IDs of the shapes in the tree
+  arr localBox;      ///< for each frame ID: center (3) and half extents (3) of the shape's mesh in frame coordinates
+  arr box;           ///< for each frame ID: the current world box (lo, hi), inflated by cutoff/2
+  uintA revision;    ///< for each frame ID: Mesh::revision of the shape's mesh the local box was computed from (0: no collision geometry)
+  std::unordered_set<uint64_t> excludedPairs;
+
+  BroadphaseInterface(const FrameL& frames, double _cutoff=.1, double margin=.05);
+
+  bool isUpToDate(const FrameL& frames) const; ///< false if frames were added or removed, or a shape or its mesh (type, size, contact) changed
+
+  uintA step(const FrameL& frames); ///< update the boxes from the frame poses and return the candidate pairs
+
+  void deactivate(const uintA& collisionExcludeIDs);
+  void deactivatePairs(const uintA& collisionExcludePairIDs);
+
+ private:
+  void computeBox(rai::Frame* f);
+  static uint64_t key(uint a, uint b) { if(a>b) std::swap(a, b);  return (uint64_t(a)<<32) | b; }
+};
+
+/// broadphase for a path configuration (e.g. KOMO's): T time slices of the same F frames, given as a T x F frame array.
+/// Local boxes and excluded pairs (in slice-local frame indices) are shared by all slices; shapes without an active dof
+/// upstream in any slice (static geometry) have the same pose in all slices and share one tree; each slice keeps its own
+/// incremental tree of the moving shapes, so that consecutive evaluations (and the pairs that persist) cost only tree updates.
+/// The classification is made at construction: construct it after all switches were applied and dofs (de)activated
+struct SliceBroadphaseInterface {
+  rai::AABBTree staticTree;
+  rai::Array<shared_ptr<rai::AABBTree>> trees; ///< per slice: the moving shapes
+  double cutoff;
+  uintA shapeIDs, staticIDs, dynamicIDs; ///< slice-local frame indices
+  boolA isStatic;
+  arr localBox;    ///< F x 6: center and half extents in frame coordinates
+  arr box;         ///< T x F x 6: world boxes (lo, hi), inflated by cutoff/2
+  std::unordered_set<uint64_t> excludedPairs;
+
+  SliceBroadphaseInterface(const FrameL& timeSlices, uint sStart=0, double _cutoff=.1, double margin=.05);
+
+  uintA step(const FrameL& timeSlices, uint sStart=0); ///< candidate pairs (frame IDs) of all slices s>=sStart
+
+  void deactivate(const uintA& collisionExcludeIDs);         ///< slice-local frame indices (= IDs in the original configuration)
+  void deactivatePairs(const uintA& collisionExcludePairIDs);
+
+ private:
+  void appendPairs(uintA& pairs, const uintA& P, const FrameL& timeSlices, uint s, const double* boxes);
+  static uint64_t key(uint a, uint b) { if(a>b) std::swap(a, b);  return (uint64_t(a)<<32) | b; }
+};
@@ -35,13 +35,11 @@ void rai::Proxy::calc_coll() {
   rai::Shape* s2 = b->shape;
   CHECK(s1 && s2, "");
 
-  double r1=0.; if(s1->size().N) r1=s1->size().last();
-  double r2=0.; if(s2->size().N) r2=s2->size().last();
-  rai::Mesh* m1 = &s1->sscCore();  if(!m1->V.N) { m1 = &s1->mesh(); r1=0.; }
-  rai::Mesh* m2 = &s2->sscCore();  if(!m2->V.N) { m2 = &s2->mesh(); r2=0.; }
+  double r1, r2;
+  rai::Mesh &m1=getCollisionMesh(r1, a), &m2=getCollisionMesh(r2, b);
 
   if(collision) collision.reset();
-  collision = make_shared<PairCollision>(*m1, *m2, s1->frame.ensure_X(), s2->frame.ensure_X(), r1, r2);
+  collision = make_shared<PairCollision>(m1, m2, s1->frame.ensure_X(), s2->frame.ensure_X(), r1, r2, nullptr, true); //a distance bound: distant pairs may be resolved on the coarse levels
 
   d = collision->distance-collision->rad1-collision->rad2;
   normal = collision->normal;
@@ -51,6 +49,18 @@ void rai::Proxy::calc_coll() {
   if(collision->rad2>0.) posB += collision->rad2*normal;
 }
 
+rai::Mesh& rai::getCollisionMesh(double& r, rai::Frame* f) {
+  static rai::Mesh dot = []() { rai::Mesh m; m.setDot(); return m; }();
+  r=0.;
+  if(!f->shape || f->shape->type()==rai::ST_marker) return dot;
+  //(reads the shape's meshes without lazily creating them: features call this concurrently)
+  r=f->shape->radius();
+  rai::Mesh* m = f->shape->_sscCore.get();
+  if(!m || !m->V.N) { m = f->shape->_mesh.get();  r=0.; }
+  if(!m || !m->V.N) return dot;
+  return *m;
+}
+
 typedef rai::Array<rai::Proxy*> ProxyL;
 
 void rai::Proxy::glDraw(OpenGL& gl) {
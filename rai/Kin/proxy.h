@@ -43,4 +43,8 @@ stdOutPipe(Proxy)
 
 void glDrawProxies(void*);
 
+/// the sphere-swept core mesh (with radius r) of the frame's shape as used by all collision queries; a dot (r=0) for frames
+/// without geometry and for marker shapes
+Mesh& getCollisionMesh(double& r, Frame* f);
+
 } //namespace rai
@@ -79,6 +79,7 @@ void LagrangianProblem::evaluate(arr& phi, arr& J, const arr& _x) {
     x=_x;
     P.evaluate(phi_x, J_x, x);
     P.getFHessian(H_x, x);
+    if(isSparseMatrix(J_x)) J_csr.set(J_x);
   } else { //we evaluated this before - use buffered values; the meta F is still recomputed as (dual) parameters might have changed
   }
   if(tt_x.N!=phi_x.N) { //need to get feature types
@@ -140,6 +141,7 @@ double LagrangianProblem::lagrangian(arr& dL, arr& HL, const arr& _x) {
     x=_x;
     P.evaluate(phi_x, J_x, x);
     P.getFHessian(H_x, x);
+    if(isSparseMatrix(J_x)) J_csr.set(J_x);
   } else { //we evaluated this before - use buffered values; the meta F is still recomputed as (dual) parameters might have changed
   }
   if(tt_x.N!=phi_x.N) { //need to get feature types
@@ -180,7 +182,8 @@ double LagrangianProblem::lagrangian(arr& dL, arr& HL, const arr& _x) {
       if(nu       && tt_x.p[i]==OT_eq) coeff.p[i] += hpenalty_d(phi_x.p[i]);                       //h-penalty
       if(lambda.N && tt_x.p[i]==OT_eq) coeff.p[i] += lambda.p[i];                                  //h-lagrange terms
     }
-    dL = comp_At_x(J_x, coeff);
+    if(isSparseMatrix(J_x)) dL = J_csr.At_x(coeff);
+    else dL = comp_At_x(J_x, coeff);
     dL.reshape(x.N);
   }
 
@@ -193,17 +196,18 @@ double LagrangianProblem::lagrangian(arr& dL, arr& HL, const arr& _x) {
       if(mu       && tt_x.p[i]==OT_ineq && I_lambda_x.p[i]) coeff.p[i] += gpenalty_dd(phi_x.p[i]);   //g-penalty
       if(nu       && tt_x.p[i]==OT_eq) coeff.p[i] += hpenalty_dd(phi_x.p[i]);                        //h-penalty
     }
-    arr tmp = J_x;
-    if(!isSpecial(tmp)) {
-      for(uint i=0; i<phi_x.N; i++) tmp[i]() *= sqrt(coeff.p[i]);
-    } else if(isSparseMatrix(tmp)){
-      arr sqrtCoeff = sqrt(coeff);
-      tmp.sparse().rowWiseMult(sqrtCoeff);
-    } else if(isRowShifted(tmp)){
-      arr sqrtCoeff = sqrt(coeff);
-      tmp.rowShifted().rowWiseMult(sqrtCoeff);
+    if(isSparseMatrix(J_x)) {
+      HL = J_csr.At_A(coeff); //Gauss-Newton type!
+    } else {
+      arr tmp = J_x;
+      if(!isSpecial(tmp)) {
+        for(uint i=0; i<phi_x.N; i++) tmp[i]() *= sqrt(coeff.p[i]);
+      } else if(isRowShifted(tmp)){
+        arr sqrtCoeff = sqrt(coeff);
+        tmp.rowShifted().rowWiseMult(sqrtCoeff);
+      }
+      HL = comp_At_A(tmp); //Gauss-Newton type!
     }
-    HL = comp_At_A(tmp); //Gauss-Newton type!
 
     if(H_x.N) { //For f-terms, the Hessian must be given explicitly, and is not \propto J^T J
       HL += H_x;
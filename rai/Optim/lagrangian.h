@@ -32,6 +32,7 @@ struct LagrangianProblem : ScalarFunction, MathematicalProgram {
   arr x;               ///< point where P was last evaluated
   arr phi_x, J_x, H_x; ///< features at x
   ObjectiveTypeA tt_x; ///< feature types at x
+  rai::CSR J_csr;      ///< compressed J_x (if sparse), keeps the symbolic structure of J^T J while the pattern of J_x is unchanged
 
   ostream* logFile=nullptr;  ///< file for logging
 
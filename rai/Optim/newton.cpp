@@ -120,14 +120,16 @@ OptNewton::StopCriterion OptNewton::step() {
     } else if(isRowShifted(R)) {
       for(uint i=0; i<R.d0; i++) R.rowShifted().entry(i, 0) += beta; //(R(i,0) is the diagonal in the packed matrix!!)
     } else if(isSparseMatrix(R)) {
-      for(uint i=0; i<R.d0; i++) R.sparse().addEntry(i, i) = beta;
+      if(rootFinding) for(uint i=0; i<R.d0; i++) R.sparse().addEntry(i, i) = beta;
+      //otherwise, the damping is added as diagonal shift within sparseSolver
     } else NIY;
   }
   {
     bool inversionFailed=false;
     try {
       if(!rootFinding) {
-        Delta = lapack_Ainv_b_sym(R, -gx);
+        if(isSparseMatrix(R)) Delta = sparseSolver.solve(R, -gx, beta);
+        else Delta = lapack_Ainv_b_sym(R, -gx);
       } else {
         lapack_mldivide(Delta, R, -gx);
       }
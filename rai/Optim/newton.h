@@ -37,4 +37,5 @@ public:
   bool rootFinding=false;
   ostream* logFile=nullptr, *simpleLog=nullptr;
   double timeNewton=0., timeEval=0.;
+  rai::SparseCholesky sparseSolver; ///< kept across steps: reuses the symbolic factorization of sparse Hessians
 };
@@ -76,7 +76,8 @@ struct Conv_MathematicalProgram_ScalarProblem : ScalarFunction {
         if(featureTypes.p[i]==OT_sos) coeff.p[i] += 2.* phi.p[i];
         else if(featureTypes.p[i]==OT_f) coeff.p[i] += 1.;
       }
-      g = comp_At_x(J, coeff);
+      if(isSparseMatrix(J)) g = rai::CSR(J).At_x(coeff);
+      else g = comp_At_x(J, coeff);
       g.reshape(x.N);
     }
 
@@ -87,14 +88,13 @@ struct Conv_MathematicalProgram_ScalarProblem : ScalarFunction {
         if(featureTypes.p[i]==OT_sos) coeff.p[i] += 2.;
         else if(featureTypes.p[i]==OT_f) hasF=true;
       }
-      arr tmp = J;
-      if(!isSparseMatrix(tmp)) {
-        for(uint i=0; i<phi.N; i++) tmp[i]() *= sqrt(coeff.p[i]);
+      if(isSparseMatrix(J)) {
+        H = rai::CSR(J).At_A(coeff); //Gauss-Newton type!
       } else {
-        arr sqrtCoeff = sqrt(coeff);
-        tmp.sparse().rowWiseMult(sqrtCoeff);
+        arr tmp = J;
+        for(uint i=0; i<phi.N; i++) tmp[i]() *= sqrt(coeff.p[i]);
+        H = comp_At_A(tmp); //Gauss-Newton type!
       }
-      H = comp_At_A(tmp); //Gauss-Newton type!
 
       if(hasF) { //For f-terms, the Hessian must be given explicitly, and is not \propto J^T J
         arr fH;
@@ -38,6 +38,7 @@ void KinectDepthPacking::open() {}
 void KinectDepthPacking::close() {}
 
 void KinectDepthPacking::step() {
+  rai::MemoryTagScope memTag(rai::MT_Perception);
   kinect_depth.readAccess();
   kinect_depthRgb.writeAccess();
 
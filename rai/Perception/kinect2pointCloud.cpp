@@ -22,6 +22,7 @@ Kinect2PointCloud::~Kinect2PointCloud() {
 }
 
 void Kinect2PointCloud::step() {
+  rai::MemoryTagScope memTag(rai::MT_Perception);
   depth = kinect_depth.get();
   rgb = kinect_rgb.get();
 
@@ -21,6 +21,7 @@ SyncFiltered::~SyncFiltered() {
 }
 
 void SyncFiltered::step() {
+  rai::MemoryTagScope memTag(rai::MT_Perception);
   uintA existingIDs;
 
   percepts.writeAccess();
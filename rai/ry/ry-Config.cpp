@@ -630,6 +630,8 @@ allows you to control robot motors by position, velocity, or accelerations, \
   ENUMVAL(FS, accumulatedCollisions)
   ENUMVAL(FS, jointLimits)
   ENUMVAL(FS, distance)
+  ENUMVAL(FS, distanceSDF)
+  ENUMVAL(FS, distanceSwept)
   ENUMVAL(FS, oppose)
 
   ENUMVAL(FS, qItself)
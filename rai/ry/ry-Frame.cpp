@@ -182,6 +182,7 @@ void init_Frame(pybind11::module& m) {
     uint n = lines.size()/3;
     self->shape->mesh().V = lines;
     self->shape->mesh().V.reshape(n, 3);
+    self->shape->mesh().touchV();
     uintA& T = self->shape->mesh().T;
     T.resize(n/2, 2);
     for(uint i=0; i<T.d0; i++) {
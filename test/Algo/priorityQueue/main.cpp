@@ -0,0 +1,68 @@
+#include <Algo/priorityQueue.h>
+
+//==============================================================================
+
+struct Item {
+  uint id;
+  double p;
+  long tie;
+};
+
+bool itemLess(const Item& a, const Item& b){ return a.p<b.p || (a.p==b.p && a.tie<b.tie); }
+
+void TEST(PopOrder){
+  //random adds (many ties, FIFO and LIFO), decreaseKeys and pops vs. a sorted reference list
+  PriorityQueue<uint> Q;
+  rai::Array<Item> ref;
+  uintA handles;  //for each item id, its handle
+  long count=0;
+  uint maxHandles=0, pops=0;
+
+  for(uint k=0; k<2000; k++){
+    double r = rnd.uni();
+    if(r<.45 || !ref.N){ //add
+      uint id = handles.N;
+      double p = rnd(10);
+      bool fromBack = rnd.uni()<.5;
+      count++;
+      handles.append(Q.add(p, id, fromBack));
+      ref.append(Item{id, p, fromBack?count:-count});
+    } else if(r<.7){ //decrease key of a random queued item
+      Item& it = ref(rnd(ref.N));
+      CHECK(Q.isQueued(handles(it.id)), "");
+      CHECK_EQ(Q.get(handles(it.id)).x, it.id, "");
+      it.p -= rnd(3);
+      Q.decreaseKey(handles(it.id), it.p);
+    } else { //pop
+      std::sort(ref.p, ref.p+ref.N, itemLess);
+      rai::Array<PriorityQueueEntry<uint>> sorted = Q.sorted();
+      CHECK_EQ(sorted.N, ref.N, "");
+      for(uint i=0; i<ref.N; i++) CHECK_EQ(sorted(i).x, ref(i).id, "sorted() is not the pop order");
+      uint id = Q.pop();
+      CHECK_EQ(id, ref(0).id, "wrong pop order");
+      CHECK(!Q.isQueued(handles(id)), "");
+      ref.remove(0);
+      pops++;
+    }
+    CHECK_EQ(Q.N, ref.N, "");
+    maxHandles = rai::MAX(maxHandles, Q.N);
+  }
+  while(ref.N){
+    std::sort(ref.p, ref.p+ref.N, itemLess);
+    CHECK_EQ(Q.pop(), ref(0).id, "wrong pop order");
+    ref.remove(0);
+  }
+  //handles of popped entries are reused: the handle index is bounded by the maximal queue size
+  CHECK_LE(Q.heapPos.N, maxHandles, "handles are not reused");
+  cout <<"priority queue: " <<handles.N <<" adds, " <<pops <<" pops in the sorted reference order, " <<Q.heapPos.N <<" handles" <<endl;
+}
+
+//==============================================================================
+
+int MAIN(int argc,char** argv){
+  rai::initCmdLine(argc, argv);
+
+  testPopOrder();
+
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include <Core/array.h>
 
+#include <thread>
+
 using namespace std;
 
 bool DoubleComp(const double& a,const double& b){ return a<b; }
@@ -243,6 +245,39 @@ void TEST(Autodiff){
 
   y = A*x;
   cout <<y <<endl <<A <<endl;
+
+  //-- a composite function, differentiated by propagating x.jac through the operations
+  arr B = randn(3,4);
+  auto f = [&B](const arr& x){
+    arr a = x({0,3}), b = x({4,7});
+    arr y = B*a;
+    y.append(sin(a) % exp(b) - 2.*b);
+    arr M = a^b;
+    y.append(M*b);
+    y.append(~M*M);
+    y.append(crossProduct(a({0,2}), b({1,3})));
+    y.append(a / (b%b + 1.));
+    y.append(sqrt(diff_sumOfSqr(b)) * 3.);
+    y.append(diff_length(a) + diff_scalarProduct(a, b) - diff_sum(y({0,2})));
+    y.append(M[2]);
+    return y;
+  };
+
+  for(bool sparse:{false, true}){
+    VectorFunction F = [&f, sparse](arr& y, arr& J, const arr& x){
+      arr q = x;
+      q.jac = make_unique<arr>(eye(x.N));
+      if(sparse) q.jac->sparse();
+      y = f(q);
+      CHECK_EQ(y.jac->d0, y.N, "");
+      CHECK_EQ(isSparseMatrix(*y.jac), sparse, "the Jacobian should keep its format");
+      if(!!J) J = *y.jac;
+      y.jac.reset();
+    };
+    arr x = randn(8);
+    cout <<"autodiff, " <<(sparse?"sparse":"dense") <<" Jacobians: ";
+    CHECK(checkJacobian(F, x, 1e-5), "");
+  }
 }
 
 //===========================================================================
@@ -357,6 +392,115 @@ void TEST(MemoryBound){
   rai::globalMemoryBound=1ull<<30;
 }
 
+void TEST(MemoryAccounting){
+  cout <<"\n*** memory accounting\n";
+  uint64_t base=rai::globalMemoryTotal, baseKOMO=rai::globalMemoryTotal.byTag(rai::MT_KOMO);
+  arr A(1000);
+  CHECK_EQ(rai::globalMemoryTotal-base, 1000*sizeof(double), "");
+  {
+    rai::MemoryTagScope tag(rai::MT_KOMO);
+    arr B(100, 100);
+    A.resize(2000); //stays accounted to its original tag
+    CHECK_EQ(rai::globalMemoryTotal.byTag(rai::MT_KOMO)-baseKOMO, 10000*sizeof(double), "");
+    CHECK_GE(rai::globalMemoryTotal.peak(), rai::globalMemoryTotal.total(), "");
+  }
+  CHECK_EQ(rai::globalMemoryTotal.byTag(rai::MT_KOMO), baseKOMO, "");
+  A.clear();
+  CHECK_EQ(rai::globalMemoryTotal, base, "");
+
+  //-- threads allocating and freeing concurrently
+  std::vector<std::thread> threads;
+  for(uint t=0; t<4; t++) threads.emplace_back([](){ for(uint i=0; i<10000; i++){ arr x(i%100+1); uintA y(7); } });
+  for(auto& th:threads) th.join();
+  CHECK_EQ(rai::globalMemoryTotal, base, "");
+  cout <<"total=" <<rai::globalMemoryTotal <<" peak=" <<rai::globalMemoryTotal.peak() <<endl;
+}
+
+//===========================================================================
+
+void TEST(Arena){
+  cout <<"\n*** scratch arena\n";
+  uint64_t base=rai::globalMemoryTotal;
+
+  //-- fresh arrays inside a scope draw from the arena; arrays sized before stay on the heap
+  arr out(10);
+  double* q;
+  {
+    rai::ArenaScope arena;
+    arr x(10);
+    CHECK(x.isArena, "");
+    q=x.p;
+    out=x;
+    CHECK(!out.isArena, "");
+    uintA big(rai::ArenaScope::chunkSize); //too large for the arena
+    CHECK(!big.isArena, "");
+  }
+  {
+    rai::ArenaScope arena;
+    arr x(10);
+    CHECK_EQ(x.p, q, "nothing escaped: the chunk should have been rewound");
+  }
+
+  //-- arrays that escape the scope keep their contents across later scopes
+  arr esc;
+  {
+    rai::ArenaScope arena;
+    arr x = range(0., 1., 99);
+    esc = x;
+    CHECK(esc.isArena, "");
+    arr m(std::move(x));
+    CHECK(m.isArena && !x.isArena && !x.p, "move does not carry the arena flag");
+  }
+  for(uint k=0;k<100;k++){
+    rai::ArenaScope arena;
+    arr y(1000);
+    y = -1.;
+  }
+  CHECK_ZERO(maxDiff(esc, range(0., 1., 99)), 0., "escaped array was overwritten");
+  esc.resize(10000); //grows out of the arena onto the heap
+  CHECK(!esc.isArena, "");
+  CHECK_ZERO(maxDiff(esc({0, 99}), range(0., 1., 99)), 0., "");
+
+  //-- swap and takeOver carry the flag
+  {
+    rai::ArenaScope arena;
+    arr a(5), b;
+    b.resize(5);
+    a = 1.;  b = 2.;
+    arr h;
+    {
+      rai::ArenaPause pause;
+      h.resize(5);
+      CHECK(!h.isArena, "allocated in the arena despite the pause");
+    }
+    h = 3.;
+    a.swap(h);
+    CHECK(!a.isArena && h.isArena && a(0)==3. && h(0)==1., "swap");
+    arr t;
+    t.takeOver(h);
+    CHECK(t.isArena && !h.isArena && h.isReference && t(0)==1., "takeOver");
+    esc = t; //copy into heap memory
+  }
+
+  //-- arrays allocated in the scope of one thread, freed on another
+  arrA fromThreads(4);
+  std::vector<std::thread> threads;
+  for(uint t=0; t<4; t++) threads.emplace_back([t, &fromThreads](){
+    rai::ArenaScope arena;
+    fromThreads(t).resize(100) = double(t);
+  });
+  for(auto& th:threads) th.join();
+  for(uint t=0; t<4; t++){
+    CHECK(fromThreads(t).isArena, "");
+    CHECK_ZERO(sum(fromThreads(t))-100.*t, 0., "");
+  }
+  fromThreads.clear(); //frees the (retired) chunks of exited threads
+
+  out.clear();  esc.clear();
+  CHECK_EQ(rai::globalMemoryTotal, base, "");
+  cout <<"arena: ok" <<endl;
+}
+
 //===========================================================================
 
 void TEST(BinaryIO){
@@ -820,6 +964,66 @@ void TEST(SparseMatrix){
 
 //===========================================================================
 
+void TEST(CSR){
+  cout <<"\n*** CSR\n";
+
+  rai::CSR C;
+  arr J(40,25);
+  for(uint k=0;k<20;k++){
+    if(k%5==0){ //new sparsity pattern every 5 iterations
+      rndGauss(J, 1.);
+      for(double& x:J) if(rnd.uni()<.8) x=0.;
+    }else{
+      for(double& x:J) if(x) x=rnd.gauss();
+    }
+    arr Js = J;
+    Js.sparse();
+    Js.sparse().add(J.sub(3,5,4,9), 3, 4, .5); //duplicate entries are summed
+    arr Jd = J;
+    Jd.setMatrixBlock(J.sub(3,5,4,9)*1.5, 3, 4);
+    C.set(Js);
+
+    arr w = rand(40), x = randn(25), y = randn(40);
+    CHECK_ZERO(maxDiff(C.A_x(x), Jd*x), 1e-10, "");
+    CHECK_ZERO(maxDiff(C.At_x(y), ~Jd*y), 1e-10, "");
+    CHECK_ZERO(maxDiff(C.A_x(eye(25)), Jd), 1e-10, "");
+    arr H = C.At_A(w);
+    CHECK(isSparseMatrix(H), "");
+    CHECK_ZERO(maxDiff(unpack(H), ~Jd*diag(w)*Jd), 1e-10, "");
+    CHECK_ZERO(maxDiff(unpack(comp_At_A(Js)), ~Jd*Jd), 1e-10, "");
+
+    CHECK_EQ(C.rowSlice(10,30).unpack(), Jd.sub(10,29,0,-1), "");
+    CHECK_EQ(C.colSlice(5,20).unpack(), Jd.sub(0,-1,5,19), "");
+    CHECK_EQ(unpack(C.getSparse()), C.unpack(), "");
+    CHECK_EQ(rai::CSR(Jd).unpack(), Jd, "");
+  }
+}
+
+//===========================================================================
+
+void TEST(SparseCholesky){
+  cout <<"\n*** SparseCholesky\n";
+
+  rai::SparseCholesky solver;
+  arr J(30,20);
+  for(uint k=0;k<10;k++){
+    rndGauss(J, 1.);
+    for(double& x:J) if(rnd.uni()<.7) x=0.; //new sparsity pattern
+    arr H = ~J*J;
+    arr Hs = H;
+    Hs.sparse();
+    arr b = randn(20);
+    for(double beta:{1e-1, 1., 10.}){ //same pattern, changing damping
+      arr x = solver.solve(Hs, b, beta);
+      CHECK_ZERO(maxDiff((H + beta*eye(20))*x, b), 1e-8, "");
+    }
+  }
+  cout <<"analyzed " <<solver.analyzeCount <<" times, factorized " <<solver.factorizeCount <<" times" <<endl;
+  CHECK_EQ(solver.analyzeCount, 10, "");
+}
+
+//===========================================================================
+
 void TEST(SparseVector){
   cout <<"\n*** SparseVector\n";
 
@@ -894,7 +1098,11 @@ void TEST(EigenValues){
 int MAIN(int argc, char **argv){
   rai::initCmdLine(argc, argv);
 
+  testCSR();
   testAutodiff();
+  testSparseCholesky();
+  testMemoryAccounting();
+  testArena();
   return 0;
 
   testBasics();
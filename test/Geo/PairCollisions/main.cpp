@@ -66,11 +66,189 @@ void TEST(PairCollision){
 
 //===========================================================================
 
+void TEST(CollisionLODs){
+  //distant pairs of distance-bound queries are resolved on the coarse levels, conservatively (a lower bound); close pairs, and
+  //all other queries (which need exact witness points), exactly on the full meshes
+  rai::Configuration C;
+  MeshA full(30);
+  for(uint i=0;i<full.N;i++){
+    rai::Frame *f = C.addFrame(STRING("obj" <<i));
+    rai::Mesh m;
+    m.setSphere(2);
+    m.scale(rnd.uni(.1,.5), rnd.uni(.1,.5), rnd.uni(.1,.5));
+    f->setConvexMesh(m.V);
+    f->setContact(1);
+    f->setPose(rai::Transformation().setRandom());
+    full(i) = f->shape->mesh();
+  }
+  makeCollisionLODs(C.frames);
+
+  uint coarse=0;
+  for(uint i=0;i<full.N;i++){
+    rai::Mesh& m = C.frames(i)->shape->mesh();
+    CHECK(m.lod, "no coarse level");
+    CHECK(full(i).lod==0, "");
+    for(uint j=i+1;j<full.N;j++){
+      const rai::Transformation &Xi=C.frames(i)->ensure_X(), &Xj=C.frames(j)->ensure_X();
+      PairCollision lod(m, C.frames(j)->shape->mesh(), Xi, Xj, 0., 0., 0, true);
+      PairCollision exact(full(i), full(j), Xi, Xj);
+      PairCollision witness(m, C.frames(j)->shape->mesh(), Xi, Xj);
+      CHECK_ZERO(witness.distance-exact.distance, 1e-10, "a query that is not distance-bound used the coarse levels");
+      CHECK_ZERO(maxDiff(witness.p1, exact.p1)+maxDiff(witness.p2, exact.p2), 1e-10, "inexact witness points");
+      if(exact.distance<=PairCollision::lodDistance){
+        CHECK_ZERO(lod.distance-exact.distance, 1e-10, "close pairs need the full meshes");
+      }else{
+        CHECK_LE(lod.distance, exact.distance+1e-10, "the coarse distance is not a lower bound");
+        if(lod.distance<exact.distance-1e-10) coarse++;
+      }
+    }
+  }
+  CHECK_GE(coarse, 1, "no pair was resolved on the coarse levels");
+
+  //-- any change of the vertices drops the coarse level
+  rai::Mesh& m = C.frames(0)->shape->mesh();
+  m.scale(1.1);
+  CHECK(!m.lod, "scale kept the coarse level");
+  makeCollisionLODs(C.frames);
+  m.transform(rai::Transformation().setRandom());
+  CHECK(!m.lod, "transform kept the coarse level");
+  makeCollisionLODs(C.frames);
+  m.V *= 2.;
+  m.touchV();
+  CHECK(!m.lod, "touchV kept the coarse level");
+  makeCollisionLODs(C.frames);
+  C.frames(0)->setShape(rai::ST_box, {.1, .2, .3});
+  CHECK(!C.frames(0)->shape->mesh().lod, "setShape kept the coarse level");
+
+  cout <<"collision LODs: " <<coarse <<" of " <<full.N*(full.N-1)/2 <<" pairs resolved on the coarse levels" <<endl;
+}
+
+//===========================================================================
+
+void TEST(PairCollisionBatch){
+  //the batch must agree with single PairCollision queries: distances, witness points and overlap flags
+  uint n=30;
+  MeshA meshes(n);
+  rai::Array<rai::Transformation> X(n);
+  arr rad(n);
+  for(uint i=0;i<n;i++){
+    meshes(i).setRandom(20);
+    meshes(i).scale(rnd.uni(.2,.6));
+    X(i).setRandom();
+    X(i).pos *= .8;
+    rad(i) = rnd.uni()<.5 ? 0. : rnd.uni(.01,.1);
+  }
+
+  PairCollisionBatch batch;
+  for(uint i=0;i<n;i++) for(uint j=i+1;j<n;j++) batch.add(meshes(i), meshes(j), X(i), X(j), rad(i), rad(j));
+  batch.compute();
+
+  uint k=0, overlaps=0;
+  for(uint i=0;i<n;i++) for(uint j=i+1;j<n;j++){
+    PairCollision pc(meshes(i), meshes(j), X(i), X(j), rad(i), rad(j));
+    CHECK_EQ(batch.overlap(k), (pc.distance<=0.), "overlap flag of pair " <<i <<'-' <<j);
+    if(batch.overlap(k)){
+      overlaps++;
+      CHECK_ZERO(batch.distance(k)+rad(i)+rad(j), 1e-10, "");
+      CHECK_ZERO(absMax(batch.normal[k]), 0., "");
+    }else{
+      CHECK_ZERO(batch.distance(k)-pc.getDistance(), 1e-6, "distance of pair " <<i <<'-' <<j);
+      CHECK_ZERO(maxDiff(batch.normal[k], pc.normal), 1e-4, "normal of pair " <<i <<'-' <<j);
+      CHECK_ZERO(maxDiff(batch.p1[k], pc.p1-rad(i)*pc.normal), 1e-4, "witness point 1 of pair " <<i <<'-' <<j);
+      CHECK_ZERO(maxDiff(batch.p2[k], pc.p2+rad(j)*pc.normal), 1e-4, "witness point 2 of pair " <<i <<'-' <<j);
+    }
+    k++;
+  }
+  CHECK_GE(overlaps, 1, "no overlapping pair tested");
+  CHECK_GE(k-overlaps, 1, "no separated pair tested");
+
+  cout <<"pair collision batch: " <<k <<" pairs (" <<overlaps <<" overlapping) agree with PairCollision" <<endl;
+}
+
+//===========================================================================
+
+void TEST(PrimitiveDistance){
+  //the closed-form distances of sphere, capsule and box cores must agree with GJK/MPR on the same geometry
+  rai::Mesh dot, seg, box;
+  dot.V = {0., 0., 0.};
+  dot.V.reshape(1, 3);
+  seg.V = {0., 0., -.2, 0., 0., .2};
+  seg.V.reshape(2, 3);
+  box.setBox();
+  box.scale(.4, .6, .8); //half extents .2, .3, .4
+  auto generic = [](const rai::Mesh& m){ //same hull, but a vertex count that is no primitive: resolved by GJK/MPR
+    rai::Mesh g;
+    g.V = m.V;
+    g.T = m.T;
+    g.V.append(~mean(m.V));
+    if(g.V.d0<3) g.V.append(~mean(m.V));
+    return g;
+  };
+  rai::Array<rai::Mesh*> prims = {&dot, &seg, &box};
+  MeshA refs = {generic(dot), generic(seg), generic(box)};
+
+  //-- separated pairs: distances and witness points
+  uint n=0;
+  for(uint i=0;i<prims.N;i++) for(uint j=0;j<prims.N;j++){
+    if(i==2 && j==2) continue; //box-box is no primitive pair
+    for(uint k=0;k<100;k++){
+      rai::Transformation X1, X2;
+      X1.setRandom();  X2.setRandom();
+      rai::Vector dir(randn(3));
+      dir.normalize();
+      X2.pos = X1.pos + rnd.uni(.7, 1.5)*dir;
+      PairCollision pc(*prims(i), *prims(j), X1, X2);
+      PairCollision ref(refs(i), refs(j), X1, X2);
+      if(ref.distance<.01) continue;
+      CHECK_ZERO(pc.distance-ref.distance, 1e-6, "distance of primitives " <<i <<'-' <<j);
+      CHECK_ZERO(maxDiff(pc.p1, ref.p1), 1e-4, "witness point 1 of primitives " <<i <<'-' <<j);
+      CHECK_ZERO(maxDiff(pc.p2, ref.p2), 1e-4, "witness point 2 of primitives " <<i <<'-' <<j);
+      CHECK_ZERO(scalarProduct(pc.normal, pc.p1-pc.p2)-pc.distance, 1e-10, "");
+      n++;
+    }
+  }
+  CHECK_GE(n, 500, "too few separated pairs tested");
+
+  //-- a point inside the box: the depth of the nearest face, on either side of the pair
+  rai::Transformation X0=0, Xp=0;
+  X0.setRandom();
+  for(uint k=0;k<100;k++){
+    rai::Vector q(rnd.uni(-.2,.2), rnd.uni(-.3,.3), rnd.uni(-.4,.4));
+    Xp.pos = X0*q;
+    double depth = rai::MIN(.2-fabs(q.x), rai::MIN(.3-fabs(q.y), .4-fabs(q.z)));
+    PairCollision pc(dot, box, Xp, X0), cp(box, dot, X0, Xp);
+    CHECK_ZERO(pc.distance+depth, 1e-10, "depth of a point inside the box");
+    CHECK_ZERO(cp.distance+depth, 1e-10, "depth of a point inside the box (swapped)");
+    CHECK_ZERO(scalarProduct(pc.normal, pc.p1-pc.p2)-pc.distance, 1e-10, "");
+    PairCollision ref(dot, refs(2), Xp, X0);
+    CHECK_GE(pc.distance, ref.distance-1e-6, "MPR found a shallower penetration"); //MPR's depth is along its portal, an upper bound
+  }
+
+  //-- touching and penetrating segment-box: left to GJK/MPR
+  rai::Transformation Xs=0, Id=0;
+  for(uint k=0;k<2;k++){
+    Xs.setZero();
+    Xs.pos.set(k ? .1 : .4, 0., 0.);  //k=0: end point on the face x=.2; k=1: through the box
+    Xs.rot.setRad(RAI_PI/2, 0., 1., 0.);
+    PairCollision pc(seg, box, Xs, Id), ref(refs(1), refs(2), Xs, Id);
+    CHECK_ZERO(pc.distance-ref.distance, 1e-6, "segment-box fallback " <<k);
+    if(!k){ CHECK_ZERO(pc.distance, 1e-6, "touching segment-box"); }
+    else{ CHECK_ZERO(pc.distance+.3, 1e-3, "penetrating segment-box"); }
+  }
+
+  cout <<"primitive distances: " <<n <<" separated pairs agree with GJK" <<endl;
+}
+
+//===========================================================================
+
 int MAIN(int argc, char** argv){
   rai::initCmdLine(argc, argv);
 
 //  rnd.clockSeed();
 
+  testPrimitiveDistance();
+  testPairCollisionBatch();
+  testCollisionLODs();
   testPairCollision();
 
   return 0;
@@ -193,9 +193,40 @@ void projectToSurface(){
 
 //===========================================================================
 
+void TEST(DistanceGrid) {
+  //the grid (built from the mesh, or sampled from the analytic function) against the analytic box distance, within the band:
+  //the error is largest close to the box edges and its medial axis (about .36*res)
+  double res=.01, band=.05;
+  DistanceFunction_ssBox box(0, .4, .3, .2, 0.);
+  rai::Mesh m;
+  m.setBox();
+  m.scale(.4, .3, .2);
+  arr lo = {-.2-band, -.15-band, -.1-band}, hi = -lo;
+  DistanceFunction_Grid grids[2] = { DistanceFunction_Grid(m, res, band), DistanceFunction_Grid(box, lo, hi, res, band) };
+
+  for(uint k=0; k<2; k++) {
+    double maxErr=0.;
+    uint n=0;
+    arr x(3);
+    for(uint i=0; i<100000; i++) {
+      for(uint j=0; j<3; j++) x(j) = rnd.uni(lo(j), hi(j));
+      double d = box(NoArr, NoArr, x);
+      if(fabs(d)>band-res) continue;
+      double e = fabs(grids[k].lookup(0, x.p) - d);
+      if(e>maxErr) maxErr=e;
+      n++;
+    }
+    cout <<(k?"sampled":"mesh") <<" grid (res " <<res <<"): max error " <<maxErr <<" over " <<n <<" points in the band" <<endl;
+    CHECK_LE(maxErr, 1.,  "grid distance too far from the analytic one");
+  }
+}
+
+//===========================================================================
+
 int MAIN(int argc, char** argv){
   rai::initCmdLine(argc, argv);
 
+  testDistanceGrid();
   testDistanceFunctions();
   testDistanceFunctions2();
   testSimpleImplicitSurfaces();
@@ -1,10 +1,17 @@
 #include <KOMO/komo.h>
 #include <Kin/TM_default.h>
 #include <Kin/F_collisions.h>
+#include <Kin/kin_broadphase.h>
+#include <Kin/proxy.h>
+#include <Geo/pairCollision.h>
 #include <Kin/viewer.h>
 #include <Kin/F_pose.h>
 #include <Optim/solver.h>
 
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
 //===========================================================================
 
 void TEST(Easy){
@@ -203,6 +210,240 @@ void TEST(PR2){
 
 //===========================================================================
 
+uintA proxyPairs(const rai::Configuration& C){
+  uintA pairs;
+  for(const rai::Proxy& p:C.proxies) pairs.append(TUP(p.a->ID, p.b->ID));
+  return pairs;
+}
+
+void TEST(SliceCollisionCache){
+  //with tolerance 0, reusing the pairs of unmoved slices has to give exactly the proxies of fresh queries (tolerance -1)
+  rai::Configuration C("arm.g");
+  uintAA pairs[2];
+  for(uint k=0;k<2;k++){
+    KOMO komo;
+    komo.opt.sliceCollisionTolerance = (k ? 0. : -1.);
+    komo.setModel(C);
+    komo.setTiming(1., 20, 5., 2);
+    komo.run_prepare(0.);
+    rnd.seed(0);
+    arr x = komo.x;
+    for(uint i=0;i<4;i++){
+      if(i==2) x({x.N/2, -1}) += randn(x.N-x.N/2); //move only the later slices
+      if(i==3) x = komo.x + randn(x.N); //move all slices
+      komo.set_x(x);
+      pairs[k].append(proxyPairs(komo.pathConfig));
+    }
+  }
+  uint n=0;
+  for(uint i=0;i<pairs[0].N;i++){
+    CHECK_EQ(pairs[0](i), pairs[1](i), "cached slice collisions differ from fresh queries (call " <<i <<")");
+    n += pairs[0](i).N/2;
+  }
+  cout <<"slice collision cache: identical proxies (" <<n <<" in total) in " <<pairs[0].N <<" calls" <<endl;
+}
+
+//===========================================================================
+
+void TEST(SliceBroadphase){
+  //pick and place: the box is static until grasped, then it moves with the arm -- the pairs (closer than swift's cutoff) of
+  //the slice broadphase need to be those of the per-slice swift/fcl queries
+  rai::Configuration C("arm.g");
+  C.addFrame("table")->setShape(rai::ST_ssBox, {1., 1., .1, .02}).setPosition({.7, -.5, .7}).setContact(1);
+  C.addFrame("box", "table")->setJoint(rai::JT_rigid).setShape(rai::ST_ssBox, {.2, .1, .1, .02}).setRelativePosition({0., 0., .1}).setContact(1);
+
+  uintAA pairs[2];
+  for(uint k=0;k<2;k++){
+    KOMO komo;
+    komo.opt.sliceBroadphase = k;
+    komo.setModel(C);
+    komo.setTiming(3., 10, 5., 2);
+    komo.addSwitch_stable(1., 2., "table", "arm7", "box");
+    komo.addSwitch_stable(2., -1., "arm7", "table", "box", false);
+    komo.run_prepare(0.);
+    rnd.seed(0);
+    for(uint i=0;i<4;i++){
+      arr x = komo.x;
+      if(i) x += .3*randn(x.N);
+      komo.set_x(x);
+      if(k) CHECK(!komo.broadphase->isStatic(C["box"]->ID), "the grasped box is not static");
+      std::vector<std::pair<uint, uint>> P;
+      for(const rai::Proxy& p:komo.pathConfig.proxies){
+        PairCollision coll(p.a->shape->mesh(), p.b->shape->mesh(), p.a->ensure_X(), p.b->ensure_X());
+        if(coll.distance<.1) P.push_back(std::minmax(p.a->ID, p.b->ID));
+      }
+      std::sort(P.begin(), P.end());
+      uintA PP;
+      for(auto& ab:P) PP.append(TUP(ab.first, ab.second));
+      pairs[k].append(PP.reshape(P.size(), 2));
+    }
+  }
+  uint n=0;
+  for(uint i=0;i<pairs[0].N;i++){
+    CHECK_EQ(pairs[0](i), pairs[1](i), "slice broadphase pairs differ from per-slice queries (call " <<i <<")");
+    n += pairs[0](i).d0;
+  }
+  cout <<"slice broadphase: identical pairs (" <<n <<" in total) in " <<pairs[0].N <<" calls" <<endl;
+}
+
+//===========================================================================
+
+void TEST(ParallelFeatures){
+  //evaluating the grounded objectives in parallel has to give exactly the phi and J of the sequential evaluation
+  rai::Configuration C("arm.g");
+  KOMO komo;
+  komo.setModel(C);
+  komo.setTiming(1., 20, 5., 2);
+  komo.add_qControlObjective({}, 2, 1.);
+  komo.addObjective({1.}, FS_positionDiff, {"endeff", "target"}, OT_eq, {1e1});
+  komo.addObjective({.5,1.}, FS_qItself, {}, OT_sos, {1e1}, {}, 1);
+  komo.addObjective({}, FS_accumulatedCollisions, {}, OT_eq, {1.});
+  komo.addObjective({}, FS_distance, {"arm7", "obstacle"}, OT_ineq, {1.});
+  komo.run_prepare(.5);
+
+  auto nlp = komo.nlp_SparseNonFactored();
+  arr phi[2], J[2];
+  for(uint k=0;k<2;k++){
+    komo.opt.parallelFeatures = k;
+    nlp->evaluate(phi[k], J[k], komo.x);
+  }
+  CHECK_EQ(phi[0], phi[1], "parallel evaluation changed phi");
+  CHECK(isSparseMatrix(J[0]) && isSparseMatrix(J[1]), "");
+  CHECK_EQ(J[0].sparse().elems, J[1].sparse().elems, "parallel evaluation changed the Jacobian pattern");
+  CHECK_EQ(J[0], J[1], "parallel evaluation changed J");
+  cout <<"parallel features: identical phi (" <<phi[0].N <<") and J (" <<J[0].N <<" non-zeros)" <<endl;
+}
+
+void TEST(ParallelCollisions){
+  //collision features evaluated concurrently (this test builds with OPENMP = 1) have to give exactly the sequential results:
+  //concurrent PairCollision queries (GJK, MPR) must not share working storage
+  rai::Configuration C;
+  for(uint i=0;i<12;i++){
+    rai::Frame *f = C.addFrame(STRING("obj" <<i));
+    rai::Mesh m;
+    m.setRandom(20);
+    m.scale(rnd.uni(.2,.5));
+    f->setConvexMesh(m.V);
+    f->setContact(1);
+  }
+  FrameL pairs;
+  for(uint i=0;i<C.frames.N;i++) for(uint j=i+1;j<C.frames.N;j++) pairs.append({C.frames(i), C.frames(j)});
+  pairs.reshape(-1, 2);
+
+  uint overlaps=0;
+  for(uint k=0;k<10;k++){
+    for(rai::Frame *f:C.frames){ rai::Transformation X; X.setRandom(); X.pos *= .5; f->setPose(X); }
+    C.ensure_q();
+    C.calc_X_batch();
+    arrA y[2], J[2];
+    for(uint p=0;p<2;p++){ y[p].resize(pairs.d0); J[p].resize(pairs.d0); }
+    for(uint i=0;i<pairs.d0;i++){
+      F_PairCollision f(F_PairCollision::_vector);
+      f.eval(y[0](i), J[0](i), pairs[i]);
+    }
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for(uint i=0;i<pairs.d0;i++){
+      F_PairCollision f(F_PairCollision::_vector);
+      f.eval(y[1](i), J[1](i), pairs[i]);
+    }
+    for(uint i=0;i<pairs.d0;i++){
+      CHECK_EQ(y[0](i), y[1](i), "concurrent collision query changed the vector of pair " <<i);
+      CHECK_EQ(J[0](i), J[1](i), "concurrent collision query changed the Jacobian of pair " <<i);
+      if(F_PairCollision().eval(pairs[i]).y.scalar()>0.) overlaps++;
+    }
+  }
+  CHECK_GE(overlaps, 1, "no penetrating pair tested");
+
+  int threads=1;
+#ifdef OPENMP
+  threads = omp_get_max_threads();
+#endif
+  cout <<"parallel collisions: " <<10*pairs.d0 <<" pair queries (" <<overlaps <<" penetrating) on " <<threads <<" threads agree with the sequential ones" <<endl;
+}
+
+//===========================================================================
+
+struct PositionDiffAs : F_PositionDiff {
+  bool rowShifted;
+  double extra=0.;
+  PositionDiffAs(bool rowShifted) : rowShifted(rowShifted) {}
+  void phi2(arr& y, arr& J, const FrameL& F){ //the same feature, but with a dense or row-shifted Jacobian
+    F_PositionDiff::phi2(y, J, F);
+    if(!J) return;
+    if(isSpecial(J)) J = unpack(J);
+    if(extra) J(0, 0) += extra; //(only to change the sparsity pattern)
+    if(rowShifted) J.rowShifted().reshift();
+  }
+};
+
+void TEST(JacobianPattern){
+  //re-evaluating with an unchanged sparsity pattern only refills the values of J: same elems, same J as a fresh assembly
+  rai::Configuration C("arm.g");
+  KOMO komo;
+  komo.setModel(C);
+  komo.setTiming(1., 20, 5., 2);
+  komo.add_qControlObjective({}, 2, 1.);
+  komo.addObjective({1.}, FS_positionDiff, {"endeff", "target"}, OT_eq, {1e1});
+  komo.addObjective({.5,1.}, FS_qItself, {}, OT_sos, {1e1}, {}, 1);
+  komo.addObjective({}, FS_distance, {"arm7", "obstacle"}, OT_ineq, {1.});
+  komo.addObjective({.8}, make_shared<PositionDiffAs>(false), {"endeff", "target"}, OT_sos, {1.});
+  komo.addObjective({.9}, make_shared<PositionDiffAs>(true), {"endeff", "target"}, OT_sos, {1.});
+  komo.run_prepare(.5);
+
+  auto nlp = komo.nlp_SparseNonFactored();
+  arr phi, J;
+  nlp->evaluate(phi, J, komo.x);
+  CHECK(isSparseMatrix(J), "");
+  intA elems = J.sparse().elems;
+  const int* elemsMem = J.sparse().elems.p;
+  arr x = komo.x + .01*randn(komo.x.N);
+  nlp->evaluate(phi, J, x);
+  CHECK(isSparseMatrix(J), "");
+  CHECK_EQ(J.sparse().elems.p, elemsMem, "the pattern was rewritten");
+  CHECK_EQ(J.sparse().elems, elems, "the pattern changed");
+
+  auto nlp2 = komo.nlp_SparseNonFactored(); //fresh assembly at the same x
+  arr phi2, J2;
+  nlp2->evaluate(phi2, J2, x);
+  CHECK_EQ(phi, phi2, "");
+  CHECK_EQ(J2.sparse().elems, elems, "");
+  CHECK_EQ(J, J2, "the re-used pattern gave different values");
+
+  //dense and row-shifted objective Jacobians only contribute their non-zeros: not more entries than the sparse feature
+  KOMO ref;
+  ref.setModel(C);
+  ref.setTiming(1., 20, 5., 2);
+  ref.add_qControlObjective({}, 2, 1.);
+  ref.addObjective({1.}, FS_positionDiff, {"endeff", "target"}, OT_eq, {1e1});
+  ref.addObjective({.5,1.}, FS_qItself, {}, OT_sos, {1e1}, {}, 1);
+  ref.addObjective({}, FS_distance, {"arm7", "obstacle"}, OT_ineq, {1.});
+  ref.addObjective({.8}, FS_positionDiff, {"endeff", "target"}, OT_sos, {1.});
+  ref.addObjective({.9}, FS_positionDiff, {"endeff", "target"}, OT_sos, {1.});
+  ref.run_prepare(.5);
+  arr phi3, J3;
+  ref.nlp_SparseNonFactored()->evaluate(phi3, J3, x);
+  CHECK_EQ(phi, phi3, "");
+  CHECK_LE(J.N, J3.N, "dense or row-shifted blocks added structural zeros");
+  CHECK_ZERO(maxDiff(unpack(J), unpack(J3)), 1e-10, "");
+
+  //a non-zero outside the recorded ones needs a full assembly
+  auto toggle = make_shared<PositionDiffAs>(false);
+  komo.addObjective({.7}, toggle, {"endeff", "target"}, OT_sos, {1.});
+  komo.run_prepare(0.);
+  nlp = komo.nlp_SparseNonFactored();
+  nlp->evaluate(phi, J, x);
+  toggle->extra = 1.;
+  nlp->evaluate(phi, J, x);
+  komo.nlp_SparseNonFactored()->evaluate(phi2, J2, x);
+  CHECK_EQ(J.sparse().elems, J2.sparse().elems, "");
+  CHECK_EQ(J, J2, "a new non-zero was dropped");
+  cout <<"jacobian pattern: re-used (" <<J.N <<" non-zeros), identical J" <<endl;
+}
+
+//===========================================================================
+
 // void TEST(FinalPosePR2){
 //   rai::Configuration K("model.g");
 //   K.pruneRigidJoints();
@@ -221,6 +462,12 @@ int main(int argc,char** argv){
 
 //  rnd.clockSeed();
 
+  testParallelCollisions();
+  testSliceCollisionCache();
+  testSliceBroadphase();
+  testParallelFeatures();
+  testJacobianPattern();
+
   testEasy();
   testAlign();
   testThin();
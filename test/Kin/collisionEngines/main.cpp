@@ -1,5 +1,6 @@
 #include <Kin/kin.h>
 #include <Kin/kin_swift.h>
+#include <Kin/kin_broadphase.h>
 #include <Gui/opengl.h>
 #include <Kin/frame.h>
 #include <Kin/viewer.h>
@@ -68,6 +69,10 @@ void TEST(CollisionTiming){
   C.fcl();
   cout <<" FCL initialization time: " <<rai::timerRead(true) <<endl;
 
+  rai::timerStart();
+  C.broadphase();
+  cout <<" Broadphase initialization time: " <<rai::timerRead(true) <<endl;
+
   arr q0,q;
   q0 = C.getJointState();
   rai::timerStart();
@@ -100,15 +105,90 @@ void TEST(CollisionTiming){
     C.reportProxies(FILE("z.col"), 0.);
 
     V.setConfiguration(C, "FCL result", true);
+
+    C.stepBroadphase();
+    cout <<"Broadphase:" <<endl;
+    cout <<"#proxies: " <<C.proxies.N <<endl;
+    cout <<"time: " <<rai::timerRead(true) <<endl;
+    cout <<"total penetration: " <<C.getTotalPenetration() <<endl; //this also calls pair collisions!!
+    cout <<"time: " <<rai::timerRead(true) <<endl;
+
+    V.setConfiguration(C, "Broadphase result", true);
   }
   cout <<" query time: " <<rai::timerRead(true) <<"sec" <<endl;
 }
 
+void TEST(Broadphase){
+  rai::Configuration C;
+  uint n=300;
+  for(uint i=0;i<n;i++){
+    rai::Frame *a = C.addFrame(STRING("obj_i"<<i));
+    a->setConvexMesh(.2*rai::Mesh().setRandom().V, {}, .02 + .1*rnd.uni());
+    if(i%10) a->setContact(1); //some without contact
+  }
+
+  uint nPairs=0;
+  for(uint t=0;t<10;t++){
+    for(rai::Frame *a:C.frames){
+      a->setPose(rai::Transformation().setRandom());
+      a->set_X()->pos.z += 1.;
+      a->set_X()->pos *= 2.;
+    }
+    if(t==5){ //edit shapes: the broadphase needs to be rebuilt
+      C.frames(1)->setShape(rai::ST_box, {1., 1., 1.});
+      C.frames(2)->setContact(0);
+      C.frames(10)->setContact(1);
+    }
+
+    shared_ptr<BroadphaseInterface> bp = C.broadphase();
+    uintA pairs = bp->step(C.frames);
+
+    //-- the boxes contain the shapes' (world) vertices
+    for(rai::Frame* a:C.frames){
+      bool inTree = a->shape && a->shape->cont;
+      CHECK_EQ(bp->shapeIDs.contains(a->ID), inTree, "");
+      if(!inTree) continue;
+      arr V = a->shape->mesh().V;
+      a->ensure_X().applyOnPointArray(V);
+      for(uint k=0;k<3;k++){
+        CHECK_LE(bp->box(a->ID, k), min(V.col(k)), "");
+        CHECK_LE(max(V.col(k)), bp->box(a->ID, 3+k), "");
+      }
+    }
+
+    //-- the tree's pairs are the brute-force overlapping boxes
+    uintA ref;
+    for(uint i=0;i<bp->shapeIDs.N;i++) for(uint j=i+1;j<bp->shapeIDs.N;j++){
+      uint a=bp->shapeIDs(i), b=bp->shapeIDs(j);
+      bool overlap=true;
+      for(uint k=0;k<3;k++) if(bp->box(a, k)>bp->box(b, 3+k) || bp->box(b, k)>bp->box(a, 3+k)) overlap=false;
+      if(overlap) ref.append(uintA{rai::MIN(a,b), rai::MAX(a,b)});
+    }
+    ref.reshape(ref.N/2, 2);
+    uintA sorted;
+    for(uint i=0;i<pairs.d0;i++) sorted.append(uintA{rai::MIN(pairs(i,0),pairs(i,1)), rai::MAX(pairs(i,0),pairs(i,1))});
+    sorted.reshape(sorted.N/2, 2);
+    auto lexSort = [](uintA& P){
+      std::vector<std::pair<uint,uint>> v;
+      for(uint i=0;i<P.d0;i++) v.push_back({P(i,0), P(i,1)});
+      std::sort(v.begin(), v.end());
+      for(uint i=0;i<P.d0;i++){ P(i,0)=v[i].first;  P(i,1)=v[i].second; }
+    };
+    lexSort(ref);
+    lexSort(sorted);
+    CHECK_EQ(sorted.d0, ref.d0, "broadphase pairs differ from brute force");
+    CHECK(sorted==ref, "broadphase pairs differ from brute force");
+    nPairs += ref.d0;
+  }
+  cout <<"broadphase pairs = brute force overlaps: " <<nPairs <<" pairs in 10 steps" <<endl;
+}
+
 int MAIN(int argc, char** argv){
   rai::initCmdLine(argc, argv);
 
 //  testSwift();
 //  testFCL();
+  testBroadphase();
   testCollisionTiming();
 
   return 0;
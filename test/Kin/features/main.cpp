@@ -106,11 +106,41 @@ void testFeature() {
 
 //===========================================================================
 
+void testSDFThinWall() {
+  //a capsule and an ssBox whose vertices are far outside of a thin wall, but whose edges (and faces) cross it
+  double res=.005, band=.05, thick=.02;
+  rai::Configuration C;
+  C.addFrame("world");
+  rai::Frame *wall = C.addFrame("wall", "world");
+  wall->setShape(rai::ST_box, {thick, 1., 1.});
+  rai::Frame *cap = C.addFrame("capsule", "world");
+  cap->setShape(rai::ST_capsule, {.4, .01});
+  cap->setJoint(rai::JT_free);
+  cap->setRelativeQuaternion({sqrt(.5), 0., sqrt(.5), 0.}); //along x, through the wall
+  rai::Frame *box = C.addFrame("box", "world");
+  box->setShape(rai::ST_ssBox, {.4, .4, .4, .01});
+  box->setJoint(rai::JT_free);
+  box->setRelativePosition({.02, .2, 0.});
+
+  for(const char* name:{"capsule", "box"}) {
+    F_PairSDF f(res, band);
+    f.setFrameIDs({name, "wall"}, C);
+    arr y;
+    f.eval(y, NoArr, f.getFrames(C));
+    cout <<name <<" vs thin wall: penetration " <<y <<endl;
+    //the core reaches the wall's middle: penetration = half thickness + radius
+    CHECK_LE(fabs(y.scalar() - (.5*thick+.01)), .4*res, "an edge crossing the thin wall was missed");
+  }
+}
+
+//===========================================================================
+
 int MAIN(int argc, char** argv){
   rai::initCmdLine(argc, argv);
 
   rnd.clockSeed();
 
+  testSDFThinWall();
   testFeature();
 
   return 0;
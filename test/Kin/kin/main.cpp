@@ -10,6 +10,8 @@
 #include <GL/gl.h>
 #include <Optim/optimization.h>
 #include <Kin/feature.h>
+#include <Kin/kin_batch.h>
+#include <thread>
 
 //===========================================================================
 //
@@ -199,6 +201,161 @@ void TEST(Copy){
   cout <<"** copy operator success" <<endl;
 }
 
+//===========================================================================
+//
+// name lookup via the frame index vs. a linear search
+//
+
+rai::Frame* findFrameLinear(const rai::Configuration& C, const char* name, bool reverse=false){
+  if(!reverse){ for(rai::Frame* f:C.frames) if(f->name==name) return f; }
+  else for(uint i=C.frames.N; i--;) if(C.frames.elem(i)->name==name) return C.frames.elem(i);
+  return 0;
+}
+
+void checkFrameLookups(const rai::Configuration& C, const StringA& names){
+  for(const rai::String& n:names) for(bool reverse:{false, true}) {
+    CHECK_EQ(C.getFrame(n, false, reverse), findFrameLinear(C, n, reverse), "lookup of '" <<n <<"' failed");
+  }
+}
+
+void TEST(FrameIndex){
+  rai::Configuration C("kinematicTests.g");
+  StringA names;
+  for(rai::Frame* f:C.frames) names.append(f->name);
+  names.append({"idx_added", "idx_new", "idx_renamed", "not_a_frame"});
+  checkFrameLookups(C, names);
+
+  //appended frames: named by addFrame, or named after construction
+  C.addFrame("idx_added", C.frames(0)->name);
+  rai::Frame* f = new rai::Frame(C);
+  f->name = "idx_new";
+  checkFrameLookups(C, names);
+
+  //copies and duplicate names
+  rai::Configuration C2(C);
+  checkFrameLookups(C2, names);
+  CHECK_EQ(C2.getFrame("idx_new")->ID, f->ID, "");
+  CHECK(C2.getFrame("idx_new")!=f, "a copy returned the frame of the original");
+  C2.addConfiguration(C);
+  checkFrameLookups(C2, names);
+  CHECK(C2.getFrame("idx_new", true, true)->ID > f->ID, "");
+
+  //renaming (with reset_frameIndex), deleting the last frame and a middle frame
+  C.frames(1)->name = "idx_renamed";
+  C.reset_frameIndex();
+  checkFrameLookups(C, names);
+  delete C.frames.last();
+  checkFrameLookups(C, names);
+  delete C.frames(2);
+  checkFrameLookups(C, names);
+  C.checkConsistency();
+
+  //lookups are read-only: concurrent lookups on the same configuration
+  const rai::Configuration& Cconst = C;
+  std::vector<std::thread> threads;
+  for(uint t=0; t<4; t++) threads.emplace_back([&Cconst, &names](){ for(uint k=0; k<100; k++) checkFrameLookups(Cconst, names); });
+  for(std::thread& th:threads) th.join();
+  cout <<"** frame index lookups success" <<endl;
+}
+
+//===========================================================================
+//
+// checkpoint & restore instead of copy
+//
+
+void TEST(Checkpoint){
+  rai::Configuration C("kinematicTests.g");
+  rai::String before, after;
+  before <<C;
+  arr q0 = C.getJointState();
+
+  rai::ConfigurationCheckpoint cp;
+  C.saveCheckpoint(cp);
+
+  //only the joint state changes
+  C.setJointState(rand(q0.N));
+  C.restoreCheckpoint(cp);
+  CHECK_ZERO(maxDiff(C.getJointState(), q0), 1e-10, "");
+
+  //structural changes
+  C.setJointState(rand(q0.N));
+  C.attach(C.frames(1), C.frames.last());
+  C.addFrame("tmp", C.frames(0)->name);
+  C.restoreCheckpoint(cp);
+  C.checkConsistency();
+  after <<C;
+  CHECK_EQ(before, after, "restore failed");
+  CHECK_ZERO(maxDiff(C.getJointState(), q0), 1e-10, "");
+
+  //joint properties, a replaced joint type and a deleted (mimicked) joint
+  rai::Joint *j2 = C["j2"]->joint, *j5 = C["|arm5"]->joint;
+  CHECK(j2 && j5 && j2->mimicers.N, "");
+  j5->limits = {-.1, .1};  j5->H = 3.;  j5->q0 = {.2};  j5->scale = 2.;
+  j5->setType(rai::JT_transX);
+  delete j2;
+  C.restoreCheckpoint(cp);
+  C.checkConsistency();
+  after.clear() <<C;
+  CHECK_EQ(before, after, "restore of joints failed");
+  CHECK(C["j2"]->joint && C["j2"]->joint->mimicers.N, "the mimicking joint was not re-attached");
+  CHECK_ZERO(maxDiff(C.getJointState(), q0), 1e-10, "");
+  cout <<"** checkpoint restore success" <<endl;
+}
+
+//===========================================================================
+//
+// batched fwd kinematics (calc_X_batch) vs. frame-by-frame ensure_X
+//
+
+void TEST(CalcXBatch){
+  rai::Configuration C("kinematicTests.g"); //mixed joint types: transXYPhi, quatBall, hinges, free, mimic
+  arr q0 = C.getJointState();
+  double maxErr=0.;
+  for(uint k=0; k<20; k++){
+    arr q = q0 + .3*randn(q0.N);
+    if(k%2) C.frames(C.frames.N/2)->set_Q()->rot.addZ(rnd.uni()); //also frames whose parents are up to date
+    C.setJointState(q);
+    C.calc_X_batch();
+    arr X = C.getFrameState();
+    C.setJointState(q);
+    for(rai::Frame* f:C.frames) f->ensure_X();
+    //the summation order differs from appendTransformation: the same poses up to rounding
+    maxErr = rai::MAX(maxErr, maxDiff(X, C.getFrameState()));
+  }
+  CHECK_ZERO(maxErr, 1e-12, "calc_X_batch differs from ensure_X");
+  cout <<"** batch fwd kinematics success (max error " <<maxErr <<")" <<endl;
+}
+
+//===========================================================================
+//
+// batch kinematics vs. one-by-one evaluation
+//
+
+void TEST(KinematicsBatch){
+  rai::Configuration C("kinematicTests.g");
+  uintA IDs = {C.frames.N-1, C.frames.N/2};
+  C.prepareSharedReading(); //the states only read the model
+  rai::KinematicsBatch batch(C, IDs, 4);
+
+  arr Q = randn(100, C.getJointStateDimension());
+  arr poses, Jpos, Jang;
+  batch.eval(poses, Jpos, Jang, Q);
+
+  arr y, J;
+  for(uint n=0;n<Q.d0;n++){
+    C.setJointState(Q[n]);
+    for(uint f=0;f<IDs.N;f++){
+      rai::Frame *a = C.frames(IDs(f));
+      CHECK_ZERO(maxDiff(a->getPose(), poses(n,f,{})), 1e-10, "");
+      C.kinematicsPos(y, J, a);
+      CHECK_ZERO(maxDiff(J, Jpos[n].sub(3*f, 3*f+2, 0, -1)), 1e-10, "");
+      C.jacobian_angular(J, a);
+      CHECK_ZERO(maxDiff(J, Jang[n].sub(3*f, 3*f+2, 0, -1)), 1e-10, "");
+    }
+  }
+  cout <<"** batch kinematics success" <<endl;
+}
+
 //===========================================================================
 //
 // Kinematic speed test
@@ -643,10 +800,14 @@ int MAIN(int argc,char **argv){
 
   testLoadSave();
   testCopy();
+  testFrameIndex();
+  testCheckpoint();
   testGraph();
   testPlayStateSequence();
   testViewerUpdate();
   testKinematics();
+  testCalcXBatch();
+  testKinematicsBatch();
   testQuaternionKinematics();
   testKinematicSpeed();
   testFollowRedundantSequence();
@@ -375,6 +375,114 @@ void testSweepingSDFs(){
 
 //===========================================================================
 
+void TEST(CollisionCaches) {
+  rai::Configuration C;
+  rai::Frame* a = C.addFrame("a");
+  a->setShape(rai::ST_ssBox, {.4, .4, .4, .05}).setPosition({0., 0., 1.});
+  FrameL B;
+  for(uint i=0; i<10; i++) {
+    rai::Frame* b = C.addFrame(STRING("b" <<i));
+    b->setShape(rai::ST_ssBox, {.2, .2, .2, .02}).setPosition({.4+.1*i, 0., 1.});
+    B.append(b);
+  }
+
+  //the cached feature must agree with a fresh (uncached) one
+  F_PairCollision f;
+  f.caches.maxSize=4;
+  arr y, y0;
+  auto check = [&](rai::Frame* b) {
+    F_PairCollision g;
+    f.eval(y, NoArr, {a, b});
+    g.eval(y0, NoArr, {a, b});
+    CHECK_ZERO(maxDiff(y, y0), 1e-10, "cached distance differs");
+    CHECK_ZERO(maxDiff(f.coll->p1, g.coll->p1)+maxDiff(f.coll->p2, g.coll->p2), 1e-6, "cached witness points differ");
+  };
+
+  //-- repeated queries of one pair: the last result is reused
+  check(B(0));
+  check(B(0));
+  shared_ptr<PairCollisionCache> cache = f.caches.caches.begin()->second;
+  CHECK_EQ(cache->reused, 1, "");
+
+  //-- a changed mesh (same vertex count and buffer) invalidates it
+  B(0)->shape->sscCore().scale(.5);
+  check(B(0));
+  CHECK_EQ(cache->reused, 1, "");
+
+  //-- warm-started queries with the cores close to contact (below libGJK's precision): core half widths are .15 and .04
+  for(double d:{1e-2, 1e-4, 5e-5, 1e-6, -1e-3}) {
+    B(0)->setPosition({.15+.04+d, 0., 1.});
+    check(B(0));
+  }
+
+  //-- the caches are bounded..
+  for(rai::Frame* b:B) check(b);
+  CHECK_LE(f.caches.caches.size(), f.caches.maxSize, "");
+
+  //-- ..and dropped on another or rebuilt configuration
+  rai::Configuration C2;
+  C2.copy(C);
+  f.eval(y, NoArr, {C2.frames(a->ID), C2.frames(B(1)->ID)});
+  CHECK_EQ(f.caches.caches.size(), 1, "");
+  CHECK_EQ(f.caches.C, &C2, "");
+  C2.addFrame("c");
+  f.eval(y, NoArr, {C2.frames(a->ID), C2.frames(B(2)->ID)});
+  CHECK_EQ(f.caches.caches.size(), 1, "");
+  CHECK_EQ(f.caches.framesN, C2.frames.N, "");
+
+  cout <<"cached pair collisions: reused " <<cache->reused <<" of " <<cache->queries <<" queries; " <<f.caches.caches.size() <<" caches" <<endl;
+}
+
+//===========================================================================
+
+void TEST(SweptCollision) {
+  //two slices of a sphere and a thin wall: the discrete checks miss what the swept one finds
+  rai::Configuration C;
+  FrameL F;
+  for(uint t=0; t<2; t++) {
+    F.append(&C.addFrame(STRING("sphere" <<t))->setShape(rai::ST_sphere, {.05}));
+    F.append(&C.addFrame(STRING("wall" <<t))->setShape(rai::ST_ssBox, {.01, 1., 1., .002}));
+  }
+  F.reshape(2, 2);
+  F_PairCollision discrete;
+  F_PairCollisionSwept swept;
+  arr y;
+
+  //-- through the wall
+  F(0, 0)->setPosition({-.5, 0., 0.});
+  F(1, 0)->setPosition({.5, 0., 0.});
+  for(uint t=0; t<2; t++) { discrete.eval(y, NoArr, F[t]);  CHECK_LE(y.scalar(), -.4, "the slices are not in collision"); }
+  swept.eval(y, NoArr, F);
+  CHECK_GE(y.scalar(), -swept.tolerance, "missed the collision between the slices");
+  CHECK_ZERO(swept.s-(.5-.057), 1e-2, "wrong time of first contact"); //sphere radius plus half the wall
+
+  //-- beside the wall (no contact): the closest approach is .05 at s=.5, the sampled minimum is no smaller
+  F(0, 0)->setPosition({-.5, .6, 0.});
+  F(1, 0)->setPosition({.5, .6, 0.});
+  swept.eval(y, NoArr, F);
+  CHECK_LE(y.scalar(), -.05+1e-6, "");
+
+  //-- a thin rod rotated by 170deg around z: its tip sweeps through a small sphere (missed when the nlerp rotation is
+  //   bounded by the slerp rate)
+  for(uint t=0; t<2; t++) {
+    F(t, 1)->setShape(rai::ST_ssBox, {1., .004, .004, .001}).setPosition({0., 0., 0.});
+    F(t, 0)->setShape(rai::ST_sphere, {.002});
+  }
+  rai::Quaternion rot;
+  rot.setRad(170.*RAI_PI/180., 0., 0., 1.);
+  F(0, 1)->setQuaternion({1., 0., 0., 0.});
+  F(1, 1)->setQuaternion({rot.w, rot.x, rot.y, rot.z});
+  double phi=53.3*RAI_PI/180.;
+  for(uint t=0; t<2; t++) F(t, 0)->setPosition({.499*cos(phi), .499*sin(phi), 0.});
+  for(uint t=0; t<2; t++) { discrete.eval(y, NoArr, F[t]);  CHECK_LE(y.scalar(), -.3, "the slices are not in collision"); }
+  swept.eval(y, NoArr, F);
+  CHECK_GE(y.scalar(), -swept.tolerance, "missed the collision of the rotating rod");
+
+  cout <<"swept collision: found contacts the slices miss" <<endl;
+}
+
+//===========================================================================
+
 int MAIN(int argc, char** argv){
   rai::initCmdLine(argc, argv);
 
@@ -383,6 +491,8 @@ int MAIN(int argc, char** argv){
   testGJK_Jacobians();
   testGJK_Jacobians2();
   testGJK_Jacobians3();
+  testCollisionCaches();
+  testSweptCollision();
 
   testFunctional();
   testSweepingSDFs();